@@ -24,17 +24,23 @@
 
 #include <fcntl.h>
 #include <glib/gstdio.h>
+#include <math.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "gstchecksumsink.h"
+#include "gstcksumfile.h"
+#include "gstcksumref.h"
 
 static gboolean gst_cksum_image_sink_start (GstBaseSink * sink);
 static gboolean gst_cksum_image_sink_stop (GstBaseSink * sink);
 static gboolean gst_cksum_image_sink_set_caps (GstBaseSink * base_sink,
     GstCaps * caps);
+static gboolean gst_cksum_image_sink_event (GstBaseSink * sink,
+    GstEvent * event);
 static gboolean gst_cksum_image_sink_propose_allocation (GstBaseSink *
     base_sink, GstQuery * query);
 static GstFlowReturn gst_cksum_image_sink_render (GstBaseSink * sink,
@@ -43,19 +49,86 @@ static void gst_cksum_image_sink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_cksum_image_sink_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static void gst_cksum_image_sink_finalize (GObject * object);
+static gboolean gst_cksum_image_sink_unlock (GstBaseSink * sink);
+static gboolean gst_cksum_image_sink_unlock_stop (GstBaseSink * sink);
+
+static guint8 *alloc_data (GstCksumImageSink * checksumsink, gsize size);
+static void free_data (GstCksumImageSink * checksumsink);
+static gboolean needs_pixels (GstCksumImageSink * checksumsink);
+static void update_hash_name (GstCksumImageSink * checksumsink);
+static gsize get_staging_size (GstCksumImageSink * checksumsink,
+    const GstVideoInfo * info);
+static GstPad *gst_cksum_image_sink_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_cksum_image_sink_release_pad (GstElement * element,
+    GstPad * pad);
+
+static gboolean start_worker (GstCksumImageSink * checksumsink);
+static void stop_worker (GstCksumImageSink * checksumsink);
+static void drain_worker (GstCksumImageSink * checksumsink);
 
 enum
 {
   PROP_0,
   PROP_HASH,
+  PROP_HASHES,
   PROP_FILE_CHECKSUM,
+  PROP_FILE_HASH,
   PROP_FRAME_CHECKSUM,
   PROP_PLANE_CHECKSUM,
   PROP_RAW_OUTPUT,
   PROP_RAW_LOCATION,
-  PROP_EOS_AFTER
+  PROP_SYNC_MODE,
+  PROP_WRITE_BEHIND,
+  PROP_HUGE_PAGES,
+  PROP_CHUNK_SIZE,
+  PROP_PLANE_MASK,
+  PROP_EOS_AFTER,
+  PROP_CACHE_DIGESTS,
+  PROP_DIGEST_MODE,
+  PROP_TILE_SIZE,
+  PROP_STRIPE_HEIGHT,
+  PROP_N_THREADS,
+  PROP_LOG_LEAVES,
+  PROP_STREAM_CHECKSUM,
+  PROP_STREAM_CHECKSUM_INTERVAL,
+  PROP_GATE_HASH,
+  PROP_GATE_REFERENCE,
+  PROP_STRONG_INTERVAL,
+  PROP_OUTPUT_FORMAT,
+  PROP_REFERENCE_LOCATION,
+  PROP_REFERENCE_FORMAT,
+  PROP_REFERENCE_KEY,
+  PROP_ALIGN_WINDOW,
+  PROP_FRAME_RANGES,
+  PROP_TIME_RANGES,
+  PROP_SEEK_TO_RANGE,
+  PROP_MEASURE_THROUGHPUT,
+  PROP_TOUCH_PAGES,
+  PROP_REPORT_INTERVAL,
+  PROP_ASYNC_HASHING,
+  PROP_LATENCY_BUDGET,
+  PROP_LIVE_MONITOR,
+  PROP_PROCESSING_TIME,
+  PROP_PROCESSING_JITTER
 };
 
+/* frames queued to the hashing thread before render() blocks, when no
+ * latency budget is set */
+#define MAX_PENDING_FRAMES 32
+
+#define DEFAULT_REPORT_INTERVAL 1000
+#define PAGE_SIZE_TOUCH 4096
+
+#define ALL_PLANES ((1 << GST_VIDEO_MAX_PLANES) - 1)
+
+#define DEFAULT_TILE_SIZE 64
+#define DEFAULT_STRIPE_HEIGHT 16
+
+/* size of the transparent huge pages on x86 and most arm64 kernels */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 static GstStaticPadTemplate gst_cksum_image_sink_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -65,6 +138,23 @@ GST_STATIC_PAD_TEMPLATE ("sink",
          "P010_10LE, I422_10LE, Y444_10LE, GRAY8, VUYA, UYVY, P012_LE, Y212_LE, "
          "Y412_LE, I420_10LE }")));
 
+/* access units whose decoded picture hash SEI is checked against the
+ * frames of the same PTS */
+static GstStaticPadTemplate gst_cksum_image_sink_sei_template =
+GST_STATIC_PAD_TEMPLATE ("sei",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("video/x-h265, stream-format = (string) byte-stream, "
+        "alignment = (string) au; "
+        "video/x-h266, stream-format = (string) byte-stream, "
+        "alignment = (string) au"));
+
+typedef struct
+{
+  gint64 pts;
+  GstCksumDph dph;
+} DphEntry;
+
 /* class initialization */
 
 #define GST_TYPE_CKSUM_IMAGE_SINK_HASH (gst_cksum_image_sink_hash_get_type ())
@@ -75,10 +165,12 @@ gst_cksum_image_sink_hash_get_type (void)
 
   if (gtype == 0) {
     static const GEnumValue values[] = {
-      {G_CHECKSUM_MD5, "MD5", "md5"},
-      {G_CHECKSUM_SHA1, "SHA-1", "sha1"},
-      {G_CHECKSUM_SHA256, "SHA-256", "sha256"},
-      {G_CHECKSUM_SHA512, "SHA-512", "sha512"},
+      {GST_CKSUM_HASH_MD5, "MD5", "md5"},
+      {GST_CKSUM_HASH_SHA1, "SHA-1", "sha1"},
+      {GST_CKSUM_HASH_SHA256, "SHA-256", "sha256"},
+      {GST_CKSUM_HASH_SHA512, "SHA-512", "sha512"},
+      {GST_CKSUM_HASH_CRC32, "CRC-32", "crc32"},
+      {GST_CKSUM_HASH_XXH64, "XXH64", "xxh64"},
       {0, NULL, NULL},
     };
 
@@ -87,6 +179,145 @@ gst_cksum_image_sink_hash_get_type (void)
   return gtype;
 }
 
+#define GST_TYPE_CKSUM_IMAGE_SINK_HASHES (gst_cksum_image_sink_hashes_get_type ())
+static GType
+gst_cksum_image_sink_hashes_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GFlagsValue values[] = {
+      {1 << GST_CKSUM_HASH_MD5, "MD5", "md5"},
+      {1 << GST_CKSUM_HASH_SHA1, "SHA-1", "sha1"},
+      {1 << GST_CKSUM_HASH_SHA256, "SHA-256", "sha256"},
+      {1 << GST_CKSUM_HASH_SHA512, "SHA-512", "sha512"},
+      {1 << GST_CKSUM_HASH_CRC32, "CRC-32", "crc32"},
+      {1 << GST_CKSUM_HASH_XXH64, "XXH64", "xxh64"},
+      {0, NULL, NULL},
+    };
+
+    gtype = g_flags_register_static ("GstCksumImageSinkHashes", values);
+  }
+  return gtype;
+}
+
+#define GST_TYPE_CKSUM_IMAGE_SINK_DIGEST_MODE \
+    (gst_cksum_image_sink_digest_mode_get_type ())
+static GType
+gst_cksum_image_sink_digest_mode_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_CKSUM_DIGEST_MODE_FLAT, "Digest of the packed frame", "flat"},
+      {GST_CKSUM_DIGEST_MODE_TILES,
+          "Root of the hash tree of the tile digests, only changed tiles "
+          "are rehashed",
+          "tiles"},
+      {GST_CKSUM_DIGEST_MODE_STRIPES,
+          "Root of the hash tree of the stripe digests, stripes are hashed "
+          "in parallel",
+          "stripes"},
+      {0, NULL, NULL},
+    };
+
+    gtype = g_enum_register_static ("GstCksumImageSinkDigestMode", values);
+  }
+  return gtype;
+}
+
+#define GST_TYPE_CKSUM_IMAGE_SINK_SYNC_MODE \
+    (gst_cksum_image_sink_sync_mode_get_type ())
+static GType
+gst_cksum_image_sink_sync_mode_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_CKSUM_SYNC_MODE_SYNC, "Flush the dump to disk when stopping",
+          "sync"},
+      {GST_CKSUM_SYNC_MODE_ASYNC,
+          "Flush the dump to disk from a separate thread", "async"},
+      {GST_CKSUM_SYNC_MODE_NONE, "Leave flushing the dump to the system",
+          "none"},
+      {0, NULL, NULL},
+    };
+
+    gtype = g_enum_register_static ("GstCksumImageSinkSyncMode", values);
+  }
+  return gtype;
+}
+
+#define GST_TYPE_CKSUM_IMAGE_SINK_HUGE_PAGES \
+    (gst_cksum_image_sink_huge_pages_get_type ())
+static GType
+gst_cksum_image_sink_huge_pages_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_CKSUM_HUGE_PAGES_NONE, "Regular pages", "none"},
+      {GST_CKSUM_HUGE_PAGES_TRANSPARENT, "Transparent huge pages",
+          "transparent"},
+      {GST_CKSUM_HUGE_PAGES_EXPLICIT,
+            "Huge pages reserved in hugetlbfs, or transparent ones if none "
+            "are available", "explicit"},
+      {0, NULL, NULL},
+    };
+
+    gtype = g_enum_register_static ("GstCksumImageSinkHugePages", values);
+  }
+  return gtype;
+}
+
+#define GST_TYPE_CKSUM_IMAGE_SINK_FORMAT \
+    (gst_cksum_image_sink_format_get_type ())
+static GType
+gst_cksum_image_sink_format_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_CKSUM_REF_FORMAT_DEFAULT, "Checksum lines of the sink", "default"},
+      {GST_CKSUM_REF_FORMAT_FRAMEMD5, "Output of ffmpeg -f framemd5",
+          "framemd5"},
+      {GST_CKSUM_REF_FORMAT_HM,
+          "Picture digests of the HM and VTM reference decoders", "hm"},
+      {0, NULL, NULL},
+    };
+
+    gtype = g_enum_register_static ("GstCksumImageSinkFormat", values);
+  }
+  return gtype;
+}
+
+#define GST_TYPE_CKSUM_IMAGE_SINK_REFERENCE_KEY \
+    (gst_cksum_image_sink_reference_key_get_type ())
+static GType
+gst_cksum_image_sink_reference_key_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_CKSUM_REF_KEY_POSITION, "Position of the frame", "position"},
+      {GST_CKSUM_REF_KEY_PTS,
+          "PTS of the frame, against the pts of framemd5", "pts"},
+      {GST_CKSUM_REF_KEY_OFFSET,
+            "Offset of the buffer, against the pts of framemd5 in its time "
+            "base or the POC of HM", "offset"},
+      {0, NULL, NULL},
+    };
+
+    gtype = g_enum_register_static ("GstCksumImageSinkReferenceKey", values);
+  }
+  return gtype;
+}
+
 #define CAT_PERFORMANCE _get_perf_category()
 static inline GstDebugCategory *
 _get_perf_category (void)
@@ -119,22 +350,49 @@ gst_cksum_image_sink_class_init (GstCksumImageSinkClass * klass)
 
   gobject_class->set_property = gst_cksum_image_sink_set_property;
   gobject_class->get_property = gst_cksum_image_sink_get_property;
+  gobject_class->finalize = gst_cksum_image_sink_finalize;
   base_sink_class->start = GST_DEBUG_FUNCPTR (gst_cksum_image_sink_start);
   base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_cksum_image_sink_stop);
   base_sink_class->set_caps = gst_cksum_image_sink_set_caps;
+  base_sink_class->event = gst_cksum_image_sink_event;
+  base_sink_class->unlock = GST_DEBUG_FUNCPTR (gst_cksum_image_sink_unlock);
+  base_sink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_cksum_image_sink_unlock_stop);
   base_sink_class->propose_allocation = gst_cksum_image_sink_propose_allocation;
   base_sink_class->render = gst_cksum_image_sink_render;
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_cksum_image_sink_request_new_pad);
+  element_class->release_pad =
+      GST_DEBUG_FUNCPTR (gst_cksum_image_sink_release_pad);
 
   g_object_class_install_property (gobject_class, PROP_HASH,
       g_param_spec_enum ("hash", "Hash", "Checksum type",
-          GST_TYPE_CKSUM_IMAGE_SINK_HASH, G_CHECKSUM_MD5,
-          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          GST_TYPE_CKSUM_IMAGE_SINK_HASH, GST_CKSUM_HASH_MD5,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_HASHES,
+      g_param_spec_flags ("hashes", "Hashes",
+          "checksum types computed together in one pass over each frame, "
+          "overriding hash when not empty; leaves and the stream checksum "
+          "use the first one",
+          GST_TYPE_CKSUM_IMAGE_SINK_HASHES, 0,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (gobject_class, PROP_FILE_CHECKSUM,
       g_param_spec_boolean ("file-checksum", "File checksum",
-          "calculate checksum for the whole raw data file (MD5 only)",
+          "calculate checksum for the whole raw data file",
           FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_FILE_HASH,
+      g_param_spec_enum ("file-hash", "File hash",
+          "checksum type of the whole file; only crc32 can combine the "
+          "digests of chunks and is hashed by n-threads threads, the other "
+          "types, including the default md5, are hashed by a single thread",
+          GST_TYPE_CKSUM_IMAGE_SINK_HASH, GST_CKSUM_HASH_MD5,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class, PROP_FRAME_CHECKSUM,
       g_param_spec_boolean ("frame-checksum", "Frame checksum",
           "calculate checksum per frame", TRUE,
@@ -155,12 +413,212 @@ gst_cksum_image_sink_class_init (GstCksumImageSinkClass * klass)
           "Location of the file to write decoded raw frames",
           NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_SYNC_MODE,
+      g_param_spec_enum ("sync-mode", "Sync mode",
+          "how the dump is flushed to disk when stopping; files removed "
+          "after the file checksum are never flushed",
+          GST_TYPE_CKSUM_IMAGE_SINK_SYNC_MODE, GST_CKSUM_SYNC_MODE_SYNC,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_WRITE_BEHIND,
+      g_param_spec_uint64 ("write-behind", "Write behind",
+          "start writing the dump to disk every N bytes and drop what was "
+          "written from the page cache (0 = disabled)", 0, G_MAXUINT64, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_HUGE_PAGES,
+      g_param_spec_enum ("huge-pages", "Huge pages",
+          "pages backing the staging buffer frames are copied to",
+          GST_TYPE_CKSUM_IMAGE_SINK_HUGE_PAGES, GST_CKSUM_HUGE_PAGES_NONE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CHUNK_SIZE,
+      g_param_spec_uint ("chunk-size", "Chunk size",
+          "stage, hash and write frames N bytes of rows at a time instead "
+          "of whole, in the flat digest mode (0 = whole frames)",
+          0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PLANE_MASK,
+      g_param_spec_uint ("plane-mask", "Plane mask",
+          "planes to checksum and dump, bit N for plane N; the others are "
+          "never read, in the flat digest mode; caps whose format has none "
+          "of these planes are refused", 1, ALL_PLANES, ALL_PLANES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class, PROP_EOS_AFTER,
       g_param_spec_int ("eos-after", "EOS After", "EOS after N buffers",
           -1, G_MAXINT, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_CACHE_DIGESTS,
+      g_param_spec_boolean ("cache-digests", "Cache digests",
+          "reuse the digests of the last frame when a buffer outside of any "
+          "pool pushes the same memory again; assumes nobody writes into "
+          "memory that was pushed", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DIGEST_MODE,
+      g_param_spec_enum ("digest-mode", "Digest mode",
+          "How frame and plane checksums are computed; the crop meta is "
+          "only proposed upstream in flat mode, the tiles being laid out "
+          "on the whole frame",
+          GST_TYPE_CKSUM_IMAGE_SINK_DIGEST_MODE, GST_CKSUM_DIGEST_MODE_FLAT,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_SIZE,
+      g_param_spec_uint ("tile-size", "Tile size",
+          "width and height in pixels of the tiles in tiles digest mode",
+          1, G_MAXUINT16, DEFAULT_TILE_SIZE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STRIPE_HEIGHT,
+      g_param_spec_uint ("stripe-height", "Stripe height",
+          "height in rows of the stripes in stripes digest mode",
+          1, G_MAXUINT16, DEFAULT_STRIPE_HEIGHT,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "threads hashing tiles and stripes in parallel (0 = one per CPU)",
+          0, G_MAXUINT16, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_LOG_LEAVES,
+      g_param_spec_boolean ("log-leaves", "Log leaves",
+          "print the digest of every tile or stripe", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STREAM_CHECKSUM,
+      g_param_spec_boolean ("stream-checksum", "Stream checksum",
+          "calculate a checksum chaining the checksums of all frames", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_STREAM_CHECKSUM_INTERVAL,
+      g_param_spec_uint ("stream-checksum-interval",
+          "Stream checksum interval",
+          "print the stream checksum every N frames (0 = at EOS only)",
+          0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_GATE_HASH,
+      g_param_spec_string ("gate-hash", "Gate hash",
+          "name of a cheap checksum type (e.g. crc32 or xxh64) computed for "
+          "every frame, the strong checksums being printed only on "
+          "reference mismatch, every strong-interval frames and for the "
+          "last frame (flat digest mode only, unset to disable)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_GATE_REFERENCE,
+      g_param_spec_string ("gate-reference", "Gate reference",
+          "file with the expected gate checksums, one per line in frame "
+          "order", NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STRONG_INTERVAL,
+      g_param_spec_uint ("strong-interval", "Strong interval",
+          "compute the strong checksums every N frames when gated "
+          "(0 = only when needed)", 0, G_MAXUINT, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_OUTPUT_FORMAT,
+      g_param_spec_enum ("output-format", "Output format",
+          "format of the printed frame checksums; framemd5 prints the frame "
+          "checksum and hm the plane checksums of the first hash type",
+          GST_TYPE_CKSUM_IMAGE_SINK_FORMAT, GST_CKSUM_REF_FORMAT_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_REFERENCE_LOCATION,
+      g_param_spec_string ("reference-location", "Reference location",
+          "file with the expected checksums of the frames, compared in "
+          "order", NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_REFERENCE_FORMAT,
+      g_param_spec_enum ("reference-format", "Reference format",
+          "format of the reference file", GST_TYPE_CKSUM_IMAGE_SINK_FORMAT,
+          GST_CKSUM_REF_FORMAT_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_REFERENCE_KEY,
+      g_param_spec_enum ("reference-key", "Reference key",
+          "what matches a frame with its reference checksums; with pts and "
+          "offset, dropped and reordered frames only affect themselves",
+          GST_TYPE_CKSUM_IMAGE_SINK_REFERENCE_KEY, GST_CKSUM_REF_KEY_POSITION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ALIGN_WINDOW,
+      g_param_spec_uint ("align-window", "Align window",
+          "number of first frames whose checksums are looked up in the "
+          "reference to find the offset of the stream in it, when compared "
+          "by position, and of mismatches in a row after which it is looked "
+          "for again (0 = compare from the first reference frame)",
+          0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FRAME_RANGES,
+      g_param_spec_string ("frame-ranges", "Frame ranges",
+          "only process the frames in these comma separated ranges of frame "
+          "numbers, e.g. \"0-9,100,500-\"", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TIME_RANGES,
+      g_param_spec_string ("time-ranges", "Time ranges",
+          "only process the frames in these comma separated ranges of "
+          "running time in seconds, or shown at these times, e.g. "
+          "\"1.5-3,42,60-\"", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SEEK_TO_RANGE,
+      g_param_spec_boolean ("seek-to-range", "Seek to range",
+          "seek upstream to the start of the first range", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MEASURE_THROUGHPUT,
+      g_param_spec_boolean ("measure-throughput", "Measure throughput",
+          "report frames/s, bytes/s and inter-arrival jitter of the buffers",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TOUCH_PAGES,
+      g_param_spec_boolean ("touch-pages", "Touch pages",
+          "read one byte of every page of the buffers to force readback "
+          "from device memory when measuring throughput", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_REPORT_INTERVAL,
+      g_param_spec_uint ("report-interval", "Report interval",
+          "interval in ms between throughput reports (0 = at stop only)",
+          0, G_MAXUINT, DEFAULT_REPORT_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ASYNC_HASHING,
+      g_param_spec_boolean ("async-hashing", "Async hashing",
+          "hash and write frames from a separate thread", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY_BUDGET,
+      g_param_spec_uint64 ("latency-budget", "Latency budget",
+          "in async mode, skip frames instead of blocking when the hashing "
+          "backlog exceeds this many nanoseconds (0 = never skip)",
+          0, G_MAXUINT64, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_LIVE_MONITOR,
+      g_param_spec_boolean ("live-monitor", "Live monitor",
+          "synchronize to the clock, take part in QoS and add the processing "
+          "time to the latency (GStreamer 1.16 and later)", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PROCESSING_TIME,
+      g_param_spec_uint64 ("processing-time", "Processing time",
+          "running average of the time spent processing a frame in ns",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PROCESSING_JITTER,
+      g_param_spec_uint64 ("processing-jitter", "Processing jitter",
+          "running average of the deviation of the processing time in ns",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&gst_cksum_image_sink_sink_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&gst_cksum_image_sink_sei_template));
 
   gst_element_class_set_static_metadata (element_class, "Checksum Image sink",
       "Debug/Sink", "Calculates a checksum for video frames",
@@ -172,10 +630,214 @@ static void
 gst_cksum_image_sink_init (GstCksumImageSink * checksumsink)
 {
   gst_base_sink_set_sync (GST_BASE_SINK (checksumsink), FALSE);
-  checksumsink->hash = G_CHECKSUM_MD5;
+  checksumsink->hash = GST_CKSUM_HASH_MD5;
+  checksumsink->file_hash = GST_CKSUM_HASH_MD5;
   checksumsink->frame_checksum = TRUE;
   checksumsink->fd = -1;
   checksumsink->eos_after = -1;
+  checksumsink->tile_size = DEFAULT_TILE_SIZE;
+  checksumsink->stripe_height = DEFAULT_STRIPE_HEIGHT;
+  checksumsink->plane_mask = ALL_PLANES;
+  checksumsink->report_interval = DEFAULT_REPORT_INTERVAL;
+  g_mutex_init (&checksumsink->pool_lock);
+  g_cond_init (&checksumsink->pool_cond);
+  g_mutex_init (&checksumsink->worker_lock);
+  g_cond_init (&checksumsink->worker_cond);
+  g_mutex_init (&checksumsink->sei_lock);
+  checksumsink->sei_expected = g_hash_table_new_full (g_int64_hash,
+      g_int64_equal, NULL, g_free);
+  checksumsink->sei_computed = g_hash_table_new_full (g_int64_hash,
+      g_int64_equal, NULL, g_free);
+  checksumsink->dph_free = g_ptr_array_new_with_free_func (g_free);
+  checksumsink->sei_rbsp = g_byte_array_new ();
+  update_hash_name (checksumsink);
+}
+
+static void
+gst_cksum_image_sink_finalize (GObject * object)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (object);
+
+  g_mutex_clear (&checksumsink->pool_lock);
+  g_cond_clear (&checksumsink->pool_cond);
+  g_mutex_clear (&checksumsink->worker_lock);
+  g_cond_clear (&checksumsink->worker_cond);
+  g_mutex_clear (&checksumsink->sei_lock);
+  g_hash_table_unref (checksumsink->sei_expected);
+  g_hash_table_unref (checksumsink->sei_computed);
+  g_ptr_array_unref (checksumsink->dph_free);
+  g_byte_array_unref (checksumsink->sei_rbsp);
+
+  g_free (checksumsink->gate_hash);
+  g_free (checksumsink->gate_reference);
+  g_free (checksumsink->reference_location);
+  g_free (checksumsink->frame_ranges_str);
+  g_free (checksumsink->time_ranges_str);
+  g_clear_pointer (&checksumsink->frame_ranges, g_array_unref);
+  g_clear_pointer (&checksumsink->time_ranges, g_array_unref);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+clear_digest_cache (GstCksumImageSink * checksumsink)
+{
+  GstCksumDigestCache *cache = &checksumsink->cache;
+
+  g_clear_pointer (&cache->mem, gst_memory_unref);
+  cache->hashes = 0;
+  cache->n_planes = 0;
+}
+
+static void
+clear_picture_hashers (GstCksumImageSink * checksumsink)
+{
+  guint i, t;
+
+  for (t = 0; t < GST_CKSUM_DPH_N_TYPES; t++) {
+    for (i = 0; i < GST_CKSUM_DPH_MAX_COMPONENTS; i++)
+      g_clear_pointer (&checksumsink->dph_ctx[t][i], gst_cksum_hasher_free);
+  }
+}
+
+static void
+clear_contexts (GstCksumImageSink * checksumsink)
+{
+  guint i, t;
+
+  for (t = 0; t < GST_CKSUM_N_HASHES; t++) {
+    for (i = 0; i < GST_VIDEO_MAX_PLANES; i++)
+      g_clear_pointer (&checksumsink->plane_ctx[t][i], gst_cksum_hasher_free);
+    g_clear_pointer (&checksumsink->frame_ctx[t], gst_cksum_hasher_free);
+  }
+  g_clear_pointer (&checksumsink->stream_ctx, gst_cksum_hasher_free);
+  g_clear_pointer (&checksumsink->gate_ctx, gst_cksum_hasher_free);
+  clear_picture_hashers (checksumsink);
+}
+
+static guint
+get_n_threads (GstCksumImageSink * checksumsink)
+{
+  if (checksumsink->n_threads > 0)
+    return checksumsink->n_threads;
+  return g_get_num_processors ();
+}
+
+static void
+clear_tiles (GstCksumImageSink * checksumsink)
+{
+  guint i;
+
+  for (i = 0; i < checksumsink->n_tiles; i++)
+    g_clear_pointer (&checksumsink->tiles[i].csum, gst_cksum_hasher_free);
+  g_clear_pointer (&checksumsink->tiles, g_free);
+  g_clear_pointer (&checksumsink->tree_nodes, g_free);
+  checksumsink->n_tiles = 0;
+  checksumsink->tiles_size = 0;
+  checksumsink->tiles_valid = FALSE;
+}
+
+/* a time in seconds, neither negative nor overflowing nanoseconds */
+static gboolean
+parse_seconds (const gchar * str, gchar ** end, guint64 * value)
+{
+  gdouble seconds = g_ascii_strtod (str, end);
+
+  if (*end == str || !isfinite (seconds) || seconds < 0
+      || seconds >= (gdouble) G_MAXUINT64 / GST_SECOND)
+    return FALSE;
+
+  *value = seconds * GST_SECOND;
+  return TRUE;
+}
+
+/* Parses comma separated "start-stop", "start-" or "n" ranges, in frame
+ * numbers or, if @is_time, in seconds, a single time selecting the frame
+ * it falls in. */
+static GArray *
+parse_ranges (GstCksumImageSink * checksumsink, const gchar * str,
+    gboolean is_time)
+{
+  GArray *ranges;
+  gchar **tokens;
+  guint i;
+
+  if (!str || !*str)
+    return NULL;
+
+  ranges = g_array_new (FALSE, FALSE, sizeof (GstCksumRange));
+  tokens = g_strsplit (str, ",", -1);
+
+  for (i = 0; tokens[i]; i++) {
+    GstCksumRange range;
+    gchar *token = g_strstrip (tokens[i]);
+    gchar *end;
+
+    if (!*token)
+      continue;
+
+    if (is_time) {
+      if (!parse_seconds (token, &end, &range.start))
+        goto invalid;
+    } else {
+      range.start = g_ascii_strtoull (token, &end, 10);
+      if (end == token)
+        goto invalid;
+    }
+
+    if (*end == '\0') {
+      range.stop = range.start;
+    } else if (*end == '-' && end[1] == '\0') {
+      range.stop = G_MAXUINT64;
+    } else if (*end == '-') {
+      token = end + 1;
+      if (is_time) {
+        if (!parse_seconds (token, &end, &range.stop))
+          goto invalid;
+      } else {
+        range.stop = g_ascii_strtoull (token, &end, 10);
+      }
+      if (end == token || *end != '\0' || range.stop < range.start)
+        goto invalid;
+    } else {
+      goto invalid;
+    }
+
+    g_array_append_val (ranges, range);
+    continue;
+
+  invalid:
+    GST_WARNING_OBJECT (checksumsink, "ignoring invalid range '%s'",
+        tokens[i]);
+  }
+
+  g_strfreev (tokens);
+
+  if (ranges->len == 0)
+    g_clear_pointer (&ranges, g_array_unref);
+
+  return ranges;
+}
+
+/* The hash contexts and the tiles are used by the streaming thread, the
+ * hashing thread and the tile pool without locking, so the properties
+ * they depend on can only change while nothing streams */
+static gboolean
+is_mutable (GstCksumImageSink * checksumsink, GParamSpec * pspec)
+{
+  GstState state, next;
+
+  GST_OBJECT_LOCK (checksumsink);
+  state = GST_STATE (checksumsink);
+  next = GST_STATE_NEXT (checksumsink);
+  GST_OBJECT_UNLOCK (checksumsink);
+
+  if (state <= GST_STATE_READY && next <= GST_STATE_READY)
+    return TRUE;
+
+  GST_WARNING_OBJECT (checksumsink, "%s can only be changed in the NULL or "
+      "READY state", pspec->name);
+  return FALSE;
 }
 
 static void
@@ -186,11 +848,29 @@ gst_cksum_image_sink_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_HASH:
+      if (!is_mutable (checksumsink, pspec))
+        break;
       checksumsink->hash = g_value_get_enum (value);
+      clear_digest_cache (checksumsink);
+      clear_tiles (checksumsink);
+      clear_contexts (checksumsink);
+      update_hash_name (checksumsink);
+      break;
+    case PROP_HASHES:
+      if (!is_mutable (checksumsink, pspec))
+        break;
+      checksumsink->hashes = g_value_get_flags (value);
+      clear_digest_cache (checksumsink);
+      clear_tiles (checksumsink);
+      clear_contexts (checksumsink);
+      update_hash_name (checksumsink);
       break;
     case PROP_FILE_CHECKSUM:
       checksumsink->file_checksum = g_value_get_boolean (value);
       break;
+    case PROP_FILE_HASH:
+      checksumsink->file_hash = g_value_get_enum (value);
+      break;
     case PROP_FRAME_CHECKSUM:
       checksumsink->frame_checksum = g_value_get_boolean (value);
       break;
@@ -203,9 +883,132 @@ gst_cksum_image_sink_set_property (GObject * object, guint prop_id,
     case PROP_RAW_LOCATION:
       checksumsink->raw_file_name = g_strdup (g_value_get_string (value));
       break;
+    case PROP_SYNC_MODE:
+      checksumsink->sync_mode = g_value_get_enum (value);
+      break;
+    case PROP_WRITE_BEHIND:
+      checksumsink->write_behind = g_value_get_uint64 (value);
+      break;
+    case PROP_HUGE_PAGES:
+      checksumsink->huge_pages = g_value_get_enum (value);
+      break;
+    case PROP_CHUNK_SIZE:
+      checksumsink->chunk_size = g_value_get_uint (value);
+      break;
+    case PROP_PLANE_MASK:
+      checksumsink->plane_mask = g_value_get_uint (value);
+      break;
     case PROP_EOS_AFTER:
       checksumsink->eos_after = g_value_get_int (value);
       break;
+    case PROP_CACHE_DIGESTS:
+      checksumsink->cache_digests = g_value_get_boolean (value);
+      clear_digest_cache (checksumsink);
+      break;
+    case PROP_DIGEST_MODE:
+      if (!is_mutable (checksumsink, pspec))
+        break;
+      checksumsink->digest_mode = g_value_get_enum (value);
+      clear_digest_cache (checksumsink);
+      clear_tiles (checksumsink);
+      break;
+    case PROP_TILE_SIZE:
+      if (!is_mutable (checksumsink, pspec))
+        break;
+      checksumsink->tile_size = g_value_get_uint (value);
+      clear_digest_cache (checksumsink);
+      clear_tiles (checksumsink);
+      break;
+    case PROP_STRIPE_HEIGHT:
+      if (!is_mutable (checksumsink, pspec))
+        break;
+      checksumsink->stripe_height = g_value_get_uint (value);
+      clear_digest_cache (checksumsink);
+      clear_tiles (checksumsink);
+      break;
+    case PROP_N_THREADS:
+      checksumsink->n_threads = g_value_get_uint (value);
+      if (checksumsink->pool)
+        g_thread_pool_set_max_threads (checksumsink->pool,
+            get_n_threads (checksumsink), NULL);
+      break;
+    case PROP_LOG_LEAVES:
+      checksumsink->log_leaves = g_value_get_boolean (value);
+      break;
+    case PROP_STREAM_CHECKSUM:
+      checksumsink->stream_checksum = g_value_get_boolean (value);
+      break;
+    case PROP_STREAM_CHECKSUM_INTERVAL:
+      checksumsink->stream_checksum_interval = g_value_get_uint (value);
+      break;
+    case PROP_GATE_HASH:
+      g_free (checksumsink->gate_hash);
+      checksumsink->gate_hash = g_value_dup_string (value);
+      checksumsink->gate_engine = NULL;
+      if (checksumsink->gate_hash && *checksumsink->gate_hash
+          && !(checksumsink->gate_engine =
+              gst_cksum_engine_find (checksumsink->gate_hash)))
+        GST_WARNING_OBJECT (checksumsink, "unknown checksum type '%s', "
+            "not gating", checksumsink->gate_hash);
+      break;
+    case PROP_GATE_REFERENCE:
+      g_free (checksumsink->gate_reference);
+      checksumsink->gate_reference = g_value_dup_string (value);
+      break;
+    case PROP_OUTPUT_FORMAT:
+      checksumsink->output_format = g_value_get_enum (value);
+      break;
+    case PROP_REFERENCE_LOCATION:
+      g_free (checksumsink->reference_location);
+      checksumsink->reference_location = g_value_dup_string (value);
+      break;
+    case PROP_REFERENCE_FORMAT:
+      checksumsink->reference_format = g_value_get_enum (value);
+      break;
+    case PROP_REFERENCE_KEY:
+      checksumsink->reference_key = g_value_get_enum (value);
+      break;
+    case PROP_ALIGN_WINDOW:
+      checksumsink->align_window = g_value_get_uint (value);
+      break;
+    case PROP_STRONG_INTERVAL:
+      checksumsink->strong_interval = g_value_get_uint (value);
+      break;
+    case PROP_FRAME_RANGES:
+      g_free (checksumsink->frame_ranges_str);
+      checksumsink->frame_ranges_str = g_value_dup_string (value);
+      g_clear_pointer (&checksumsink->frame_ranges, g_array_unref);
+      checksumsink->frame_ranges = parse_ranges (checksumsink,
+          checksumsink->frame_ranges_str, FALSE);
+      break;
+    case PROP_TIME_RANGES:
+      g_free (checksumsink->time_ranges_str);
+      checksumsink->time_ranges_str = g_value_dup_string (value);
+      g_clear_pointer (&checksumsink->time_ranges, g_array_unref);
+      checksumsink->time_ranges = parse_ranges (checksumsink,
+          checksumsink->time_ranges_str, TRUE);
+      break;
+    case PROP_SEEK_TO_RANGE:
+      checksumsink->seek_to_range = g_value_get_boolean (value);
+      break;
+    case PROP_MEASURE_THROUGHPUT:
+      checksumsink->measure_throughput = g_value_get_boolean (value);
+      break;
+    case PROP_TOUCH_PAGES:
+      checksumsink->touch_pages = g_value_get_boolean (value);
+      break;
+    case PROP_REPORT_INTERVAL:
+      checksumsink->report_interval = g_value_get_uint (value);
+      break;
+    case PROP_ASYNC_HASHING:
+      checksumsink->async_hashing = g_value_get_boolean (value);
+      break;
+    case PROP_LATENCY_BUDGET:
+      checksumsink->latency_budget = g_value_get_uint64 (value);
+      break;
+    case PROP_LIVE_MONITOR:
+      checksumsink->live_monitor = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -222,9 +1025,15 @@ gst_cksum_image_sink_get_property (GObject * object, guint prop_id,
     case PROP_HASH:
       g_value_set_enum (value, checksumsink->hash);
       break;
+    case PROP_HASHES:
+      g_value_set_flags (value, checksumsink->hashes);
+      break;
     case PROP_FILE_CHECKSUM:
       g_value_set_boolean (value, checksumsink->file_checksum);
       break;
+    case PROP_FILE_HASH:
+      g_value_set_enum (value, checksumsink->file_hash);
+      break;
     case PROP_FRAME_CHECKSUM:
       g_value_set_boolean (value, checksumsink->frame_checksum);
       break;
@@ -237,183 +1046,2470 @@ gst_cksum_image_sink_get_property (GObject * object, guint prop_id,
     case PROP_RAW_LOCATION:
       g_value_set_string (value, checksumsink->raw_file_name);
       break;
+    case PROP_SYNC_MODE:
+      g_value_set_enum (value, checksumsink->sync_mode);
+      break;
+    case PROP_WRITE_BEHIND:
+      g_value_set_uint64 (value, checksumsink->write_behind);
+      break;
+    case PROP_HUGE_PAGES:
+      g_value_set_enum (value, checksumsink->huge_pages);
+      break;
+    case PROP_CHUNK_SIZE:
+      g_value_set_uint (value, checksumsink->chunk_size);
+      break;
+    case PROP_PLANE_MASK:
+      g_value_set_uint (value, checksumsink->plane_mask);
+      break;
     case PROP_EOS_AFTER:
       g_value_set_int (value, checksumsink->eos_after);
       break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    case PROP_CACHE_DIGESTS:
+      g_value_set_boolean (value, checksumsink->cache_digests);
       break;
-  }
-}
-
-static gboolean
-open_raw_file (GstCksumImageSink * checksumsink)
-{
-  GError *err;
-
-  if (!checksumsink->file_checksum && !checksumsink->dump_output)
-    return TRUE;
-
-  if (checksumsink->fd != -1)
-    return TRUE;
-  else if (checksumsink->raw_file_name)
-    checksumsink->fd = g_open (checksumsink->raw_file_name, O_WRONLY | O_CREAT,
-        S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
-  else
+    case PROP_DIGEST_MODE:
+      g_value_set_enum (value, checksumsink->digest_mode);
+      break;
+    case PROP_TILE_SIZE:
+      g_value_set_uint (value, checksumsink->tile_size);
+      break;
+    case PROP_STRIPE_HEIGHT:
+      g_value_set_uint (value, checksumsink->stripe_height);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, checksumsink->n_threads);
+      break;
+    case PROP_LOG_LEAVES:
+      g_value_set_boolean (value, checksumsink->log_leaves);
+      break;
+    case PROP_STREAM_CHECKSUM:
+      g_value_set_boolean (value, checksumsink->stream_checksum);
+      break;
+    case PROP_STREAM_CHECKSUM_INTERVAL:
+      g_value_set_uint (value, checksumsink->stream_checksum_interval);
+      break;
+    case PROP_GATE_HASH:
+      g_value_set_string (value, checksumsink->gate_hash);
+      break;
+    case PROP_GATE_REFERENCE:
+      g_value_set_string (value, checksumsink->gate_reference);
+      break;
+    case PROP_OUTPUT_FORMAT:
+      g_value_set_enum (value, checksumsink->output_format);
+      break;
+    case PROP_REFERENCE_LOCATION:
+      g_value_set_string (value, checksumsink->reference_location);
+      break;
+    case PROP_REFERENCE_FORMAT:
+      g_value_set_enum (value, checksumsink->reference_format);
+      break;
+    case PROP_REFERENCE_KEY:
+      g_value_set_enum (value, checksumsink->reference_key);
+      break;
+    case PROP_ALIGN_WINDOW:
+      g_value_set_uint (value, checksumsink->align_window);
+      break;
+    case PROP_STRONG_INTERVAL:
+      g_value_set_uint (value, checksumsink->strong_interval);
+      break;
+    case PROP_FRAME_RANGES:
+      g_value_set_string (value, checksumsink->frame_ranges_str);
+      break;
+    case PROP_TIME_RANGES:
+      g_value_set_string (value, checksumsink->time_ranges_str);
+      break;
+    case PROP_SEEK_TO_RANGE:
+      g_value_set_boolean (value, checksumsink->seek_to_range);
+      break;
+    case PROP_MEASURE_THROUGHPUT:
+      g_value_set_boolean (value, checksumsink->measure_throughput);
+      break;
+    case PROP_TOUCH_PAGES:
+      g_value_set_boolean (value, checksumsink->touch_pages);
+      break;
+    case PROP_REPORT_INTERVAL:
+      g_value_set_uint (value, checksumsink->report_interval);
+      break;
+    case PROP_ASYNC_HASHING:
+      g_value_set_boolean (value, checksumsink->async_hashing);
+      break;
+    case PROP_LATENCY_BUDGET:
+      g_value_set_uint64 (value, checksumsink->latency_budget);
+      break;
+    case PROP_LIVE_MONITOR:
+      g_value_set_boolean (value, checksumsink->live_monitor);
+      break;
+    case PROP_PROCESSING_TIME:
+      g_mutex_lock (&checksumsink->worker_lock);
+      g_value_set_uint64 (value, checksumsink->proc_time);
+      g_mutex_unlock (&checksumsink->worker_lock);
+      break;
+    case PROP_PROCESSING_JITTER:
+      g_mutex_lock (&checksumsink->worker_lock);
+      g_value_set_uint64 (value, checksumsink->proc_jitter);
+      g_mutex_unlock (&checksumsink->worker_lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/* Everything the sink prints goes to stdout through these two, never
+ * through g_print(), which allocates: a print handler set with
+ * g_set_print_handler() doesn't see any of it, rather than only the
+ * per frame lines. */
+static void
+log_puts (const gchar * text)
+{
+  fputs (text, stdout);
+  fflush (stdout);
+}
+
+/* the longest line, a ReferenceMismatch of two HM plane digests */
+#define LOG_LINE_SIZE (2 * GST_VIDEO_MAX_PLANES * GST_CKSUM_MAX_HEX_SIZE + 64)
+
+/* formats into a buffer on the stack */
+static void G_GNUC_PRINTF (1, 2)
+log_printf (const gchar * format, ...)
+{
+  gchar line[LOG_LINE_SIZE];
+  va_list args;
+  gint len;
+
+  va_start (args, format);
+  len = g_vsnprintf (line, sizeof (line), format, args);
+  va_end (args);
+
+  if (len >= (gint) sizeof (line))
+    GST_WARNING ("log line of %d bytes truncated", len);
+  log_puts (line);
+}
+
+/* mask of the hash types computed for each frame */
+static guint
+get_hashes (GstCksumImageSink * checksumsink)
+{
+  if (checksumsink->hashes)
+    return checksumsink->hashes;
+  return 1 << checksumsink->hash;
+}
+
+/* the hash type of the leaves and of the stream checksum */
+static GstCksumHashType
+get_primary_hash (GstCksumImageSink * checksumsink)
+{
+  return g_bit_nth_lsf (get_hashes (checksumsink), -1);
+}
+
+/* the upper-case name of the primary hash type, as printed in the
+ * framemd5 header and the HM lines */
+static void
+update_hash_name (GstCksumImageSink * checksumsink)
+{
+  const gchar *name = gst_cksum_engine_get (get_primary_hash
+      (checksumsink))->name;
+  guint i;
+
+  for (i = 0; name[i] && i < sizeof (checksumsink->hash_name) - 1; i++)
+    checksumsink->hash_name[i] = g_ascii_toupper (name[i]);
+  checksumsink->hash_name[i] = '\0';
+}
+
+/* Fills @types with the hash types computed for each frame, in
+ * increasing order, and returns their number */
+static guint
+get_hash_types (GstCksumImageSink * checksumsink,
+    GstCksumHashType types[GST_CKSUM_N_HASHES])
+{
+  guint hashes = get_hashes (checksumsink);
+  guint t, n = 0;
+
+  for (t = 0; t < GST_CKSUM_N_HASHES; t++) {
+    if (hashes & (1 << t))
+      types[n++] = t;
+  }
+  return n;
+}
+
+/* Returns *@ctx reset for a new digest, creating it on first use */
+static GstCksumHasher *
+get_context (GstCksumHashType type, GstCksumHasher ** ctx)
+{
+  if (*ctx)
+    gst_cksum_hasher_reset (*ctx);
+  else
+    *ctx = gst_cksum_hasher_new (type);
+  return *ctx;
+}
+
+/* Writes the digest of @ctx as hex into @hex, which must hold at least
+ * GST_CKSUM_MAX_HEX_SIZE bytes */
+static void
+finish_context (GstCksumHasher * ctx, gchar * hex)
+{
+  gst_cksum_hasher_final_string (ctx, hex);
+}
+
+/* the format of the loaded reference, which for an index is the one of
+ * its header whatever reference-format says */
+static GstCksumRefFormat
+get_reference_format (GstCksumImageSink * checksumsink)
+{
+  if (checksumsink->reference)
+    return checksumsink->reference->format;
+  return checksumsink->reference_format;
+}
+
+/* the frame checksum is computed when printed or chained */
+static gboolean
+needs_frame_checksum (GstCksumImageSink * checksumsink)
+{
+  return checksumsink->frame_checksum || checksumsink->stream_checksum
+      || checksumsink->output_format == GST_CKSUM_REF_FORMAT_FRAMEMD5
+      || (checksumsink->reference_location
+      && get_reference_format (checksumsink) != GST_CKSUM_REF_FORMAT_HM);
+}
+
+/* the plane checksums are computed when printed or compared */
+static gboolean
+needs_plane_checksum (GstCksumImageSink * checksumsink)
+{
+  return checksumsink->plane_checksum
+      || checksumsink->output_format == GST_CKSUM_REF_FORMAT_HM
+      || (checksumsink->reference_location
+      && get_reference_format (checksumsink) == GST_CKSUM_REF_FORMAT_HM);
+}
+
+/* the digests of the planes separated by commas */
+static void
+join_plane_checksums (gchar * text,
+    gchar (*plane_csum)[GST_CKSUM_MAX_HEX_SIZE], guint n_planes)
+{
+  gchar *p = text;
+  guint i;
+
+  for (i = 0; i < n_planes; i++) {
+    if (i > 0)
+      *p++ = ',';
+    p = g_stpcpy (p, plane_csum[i]);
+  }
+  *p = '\0';
+}
+
+/* ffmpeg -f framemd5 lines, in the time base of the frame rate, @n
+ * standing for the pts when the frame has none */
+static void
+print_framemd5 (GstCksumImageSink * checksumsink, guint64 n,
+    const gchar * hex)
+{
+  GstVideoInfo *vinfo = &checksumsink->vinfo;
+  gint tb_num = GST_VIDEO_INFO_FPS_D (vinfo);
+  gint tb_den = GST_VIDEO_INFO_FPS_N (vinfo);
+  gint64 pts, duration = 1;
+
+  /* milliseconds for variable frame rates */
+  if (tb_den <= 0) {
+    tb_num = 1;
+    tb_den = 1000;
+    duration = 0;
+  }
+
+  if (!checksumsink->header_printed) {
+    checksumsink->header_printed = TRUE;
+    log_printf ("#format: frame checksums\n#version: 2\n#hash: %s\n"
+        "#tb 0: %d/%d\n#media_type 0: video\n#codec_id 0: rawvideo\n"
+        "#dimensions 0: %ux%u\n#sar 0: %d/%d\n"
+        "#stream#, dts,        pts, duration,     size, hash\n",
+        checksumsink->hash_name,
+        tb_num, tb_den, checksumsink->frame_width,
+        checksumsink->frame_height, GST_VIDEO_INFO_PAR_N (vinfo),
+        GST_VIDEO_INFO_PAR_D (vinfo));
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (checksumsink->frame_pts))
+    pts = gst_util_uint64_scale_round (checksumsink->frame_pts, tb_den,
+        tb_num * GST_SECOND);
+  else
+    pts = n;
+
+  log_printf ("0, %10" G_GINT64_FORMAT ", %10" G_GINT64_FORMAT ", %8"
+      G_GINT64_FORMAT ", %8" G_GSIZE_FORMAT ", %s\n", pts, pts, duration,
+      checksumsink->frame_size, hex);
+}
+
+#define REF_SEEN(s, i) ((s)->ref_seen[(i) / 8] & (1 << ((i) % 8)))
+#define REF_SET_SEEN(s, i) ((s)->ref_seen[(i) / 8] |= 1 << ((i) % 8))
+
+/* Fills @entry with the reference entry of the frame at @position, and
+ * @key with its key. Returns FALSE if the reference has none. Keyed
+ * entries are marked as seen, so that the others are the missing frames
+ * at the end. */
+static gboolean
+lookup_reference (GstCksumImageSink * checksumsink, guint64 position,
+    gint64 * key, GstCksumRefEntry * entry)
+{
+  GstCksumRef *ref = checksumsink->reference;
+  gint64 found;
+
+  switch (checksumsink->reference_key) {
+    case GST_CKSUM_REF_KEY_PTS:
+      /* in the time base of the reference */
+      *key = GST_CLOCK_TIME_IS_VALID (checksumsink->frame_pts) ?
+          (gint64) gst_util_uint64_scale_round (checksumsink->frame_pts,
+          ref->tb_den, (guint64) ref->tb_num * GST_SECOND) : -1;
+      break;
+    case GST_CKSUM_REF_KEY_OFFSET:
+      *key = checksumsink->frame_offset != GST_BUFFER_OFFSET_NONE ?
+          (gint64) checksumsink->frame_offset : -1;
+      break;
+    case GST_CKSUM_REF_KEY_POSITION:
+    default:
+      *key = (gint64) position + checksumsink->ref_offset;
+      return *key >= 0 && gst_cksum_ref_get_entry (ref, *key, entry);
+  }
+
+  if (*key < 0 || (found = gst_cksum_ref_find (ref, *key)) < 0
+      || REF_SEEN (checksumsink, found))
+    return FALSE;
+  REF_SET_SEEN (checksumsink, found);
+  return gst_cksum_ref_get_entry (ref, found, entry);
+}
+
+/* Compares @digest of the frame at @position with the one of the
+ * reference with the same key. Returns TRUE if they match. */
+static gboolean
+compare_reference (GstCksumImageSink * checksumsink, guint64 position,
+    const gchar * digest)
+{
+  GstCksumRefEntry entry;
+  gint64 key;
+
+  if (!lookup_reference (checksumsink, position, &key, &entry)) {
+    log_printf ("ReferenceExtra %" G_GINT64_FORMAT "\n", key);
+    checksumsink->ref_extra++;
+    return FALSE;
+  }
+
+  checksumsink->ref_matched++;
+  if (g_ascii_strcasecmp (entry.digest, digest) == 0)
+    return TRUE;
+
+  GST_WARNING_OBJECT (checksumsink, "checksum of frame %" G_GINT64_FORMAT
+      " is %s, expected %s", key, digest, entry.digest);
+  log_printf ("ReferenceMismatch %" G_GINT64_FORMAT " %s %s\n", key,
+      entry.digest, digest);
+  checksumsink->ref_mismatches++;
+  return FALSE;
+}
+
+static gint
+compare_offsets (gconstpointer a, gconstpointer b)
+{
+  gint64 oa = *(const gint64 *) a, ob = *(const gint64 *) b;
+
+  return oa < ob ? -1 : oa > ob;
+}
+
+/* Looks up @digests, the ones of the frames from @start, in the digest
+ * order of the reference, and sets @offset to the offset of the stream in
+ * it most of the frames found agree on. Digests found more than once
+ * can't tell where the stream is and don't vote. Returns the number of
+ * votes for @offset, 0 if it has no majority, and sets @n_found to the
+ * number of frames found. */
+static guint
+find_reference_offset (GstCksumImageSink * checksumsink, GPtrArray * digests,
+    guint64 start, gint64 * offset, guint * n_found)
+{
+  GstCksumRef *ref = checksumsink->reference;
+  GArray *offsets;
+  const gchar *digest;
+  guint64 position;
+  gint64 o;
+  guint i, run, votes = 0;
+
+  offsets = g_array_sized_new (FALSE, FALSE, sizeof (gint64), digests->len);
+  for (i = 0; i < digests->len; i++) {
+    /* skipped frames hold their position with no digest */
+    if (!(digest = g_ptr_array_index (digests, i))
+        || gst_cksum_ref_find_digest (ref, digest, &position) != 1)
+      continue;
+    o = (gint64) position - (gint64) (start + i);
+    g_array_append_val (offsets, o);
+  }
+
+  /* the longest run of equal offsets wins */
+  g_array_sort (offsets, compare_offsets);
+  for (i = 0; i < offsets->len; i += run) {
+    o = g_array_index (offsets, gint64, i);
+    run = 1;
+    while (i + run < offsets->len
+        && g_array_index (offsets, gint64, i + run) == o)
+      run++;
+    if (run > votes) {
+      votes = run;
+      *offset = o;
+    }
+  }
+
+  *n_found = offsets->len;
+  g_array_unref (offsets);
+
+  return votes * 2 > *n_found ? votes : 0;
+}
+
+/* Picks the offset of the stream in the reference most of the pending
+ * frames found in it agree on, then compares them from there */
+static void
+align_reference (GstCksumImageSink * checksumsink)
+{
+  GPtrArray *pending = checksumsink->align_pending;
+  gint64 offset = 0;
+  guint i, votes, n_found;
+
+  votes = find_reference_offset (checksumsink, pending, 0, &offset,
+      &n_found);
+  if (votes > 0) {
+    GST_INFO_OBJECT (checksumsink, "stream starts at reference frame %"
+        G_GINT64_FORMAT " (%u of %u frames agree)", offset, votes,
+        pending->len);
+    log_printf ("ReferenceOffset %" G_GINT64_FORMAT "\n", offset);
+  } else {
+    GST_WARNING_OBJECT (checksumsink, "no offset in the reference matches "
+        "most of the first %u frames, comparing from its start",
+        pending->len);
+    log_printf ("ReferenceAlignmentFailed\n");
+    offset = 0;
+  }
+
+  /* later frames are compared as they come */
+  checksumsink->ref_offset = offset;
+  checksumsink->align_pending = NULL;
+  for (i = 0; i < pending->len; i++) {
+    if (g_ptr_array_index (pending, i))
+      compare_reference (checksumsink, i, g_ptr_array_index (pending, i));
+  }
+  g_ptr_array_unref (pending);
+}
+
+/* Collects the digests of a run of mismatching frames, and once it is
+ * align-window frames long looks them up in the reference again, so that
+ * the comparison follows a stream that jumped, e.g. after a lost or
+ * repeated frame. The frames of the run stay reported as mismatches. */
+static void
+realign_reference (GstCksumImageSink * checksumsink, const gchar * digest)
+{
+  GPtrArray *run = checksumsink->realign_digests;
+  gint64 offset = 0;
+  guint votes, n_found;
+
+  if (run->len == 0)
+    checksumsink->realign_start = checksumsink->reported_frames;
+  g_ptr_array_add (run, g_strdup (digest));
+  if (run->len < checksumsink->align_window)
+    return;
+
+  votes = find_reference_offset (checksumsink, run,
+      checksumsink->realign_start, &offset, &n_found);
+  if (votes > 0 && offset != checksumsink->ref_offset) {
+    GST_INFO_OBJECT (checksumsink, "stream moved to reference frame %"
+        G_GINT64_FORMAT " (%u of %u frames agree)",
+        (gint64) checksumsink->realign_start + offset, votes, run->len);
+    log_printf ("ReferenceOffset %" G_GINT64_FORMAT "\n", offset);
+    checksumsink->ref_offset = offset;
+  }
+  g_ptr_array_set_size (run, 0);
+}
+
+/* Compares the digests of the frame with the ones of the reference, once
+ * the window of frames to align with it is full when there is one */
+static void
+check_reference (GstCksumImageSink * checksumsink,
+    gchar (*plane_csum)[GST_CKSUM_MAX_HEX_SIZE], const gchar * frame_csum,
+    guint n_planes)
+{
+  GstCksumRef *ref = checksumsink->reference;
+  gchar planes[GST_VIDEO_MAX_PLANES * GST_CKSUM_MAX_HEX_SIZE];
+  const gchar *digest = frame_csum;
+
+  if (!ref)
+    return;
+
+  if (ref->format == GST_CKSUM_REF_FORMAT_HM) {
+    join_plane_checksums (planes, plane_csum, n_planes);
+    digest = planes;
+  }
+
+  if (checksumsink->align_pending) {
+    g_ptr_array_add (checksumsink->align_pending, g_strdup (digest));
+    if (checksumsink->align_pending->len >= checksumsink->align_window)
+      align_reference (checksumsink);
+    return;
+  }
+
+  if (compare_reference (checksumsink, checksumsink->reported_frames,
+          digest)) {
+    if (checksumsink->realign_digests)
+      g_ptr_array_set_size (checksumsink->realign_digests, 0);
+  } else if (checksumsink->realign_digests) {
+    realign_reference (checksumsink, digest);
+  }
+}
+
+/* Checks that the reference has the key the frames are matched with,
+ * and tracks the frames seen by key */
+static gboolean
+index_reference (GstCksumImageSink * checksumsink)
+{
+  GstCksumRef *ref = checksumsink->reference;
+
+  /* the frames are looked up by digest in the reference to align with
+   * it, at the start and after align-window mismatches in a row */
+  if (checksumsink->reference_key == GST_CKSUM_REF_KEY_POSITION) {
+    if (checksumsink->align_window > 0) {
+      checksumsink->align_pending = g_ptr_array_new_with_free_func (g_free);
+      checksumsink->realign_digests =
+          g_ptr_array_new_with_free_func (g_free);
+    }
+    return TRUE;
+  }
+
+  if (checksumsink->align_window > 0)
+    GST_WARNING_OBJECT (checksumsink, "frames compared by key, ignoring "
+        "align-window");
+
+  if (ref->format == GST_CKSUM_REF_FORMAT_DEFAULT
+      || (checksumsink->reference_key == GST_CKSUM_REF_KEY_PTS
+          && (ref->format != GST_CKSUM_REF_FORMAT_FRAMEMD5
+              || ref->tb_num <= 0 || ref->tb_den <= 0))) {
+    GST_ELEMENT_ERROR (checksumsink, RESOURCE, SETTINGS,
+        ("the reference has no %s for its frames",
+            checksumsink->reference_key == GST_CKSUM_REF_KEY_PTS ?
+            "pts" : "offset"), (NULL));
+    return FALSE;
+  }
+
+  checksumsink->ref_seen =
+      g_malloc0 (gst_cksum_ref_get_n_entries (ref) / 8 + 1);
+
+  return TRUE;
+}
+
+/* Prints the keys never seen in key order, entries after the first one
+ * with a key being ignored as the lookups never return them, and returns
+ * their number */
+static guint64
+print_missing_references (GstCksumImageSink * checksumsink)
+{
+  GstCksumRef *ref = checksumsink->reference;
+  guint64 n = gst_cksum_ref_get_n_entries (ref);
+  guint64 i, position, missing = 0;
+  GstCksumRefEntry entry;
+  gint64 last = -1;
+
+  for (i = 0; i < n; i++) {
+    position = gst_cksum_ref_get_sorted (ref, i);
+    if (!gst_cksum_ref_get_entry (ref, position, &entry) || entry.pts < 0
+        || entry.pts == last)
+      continue;
+    last = entry.pts;
+    if (REF_SEEN (checksumsink, position))
+      continue;
+    log_printf ("ReferenceMissingFrame %" G_GINT64_FORMAT "\n", entry.pts);
+    missing++;
+  }
+
+  return missing;
+}
+
+static gboolean
+load_reference (GstCksumImageSink * checksumsink)
+{
+  const GstCksumEngine *engine;
+  GError *err = NULL;
+
+  if (!checksumsink->reference_location)
+    return TRUE;
+
+  engine = gst_cksum_engine_get (get_primary_hash (checksumsink));
+  checksumsink->reference =
+      gst_cksum_ref_load (checksumsink->reference_location,
+      checksumsink->reference_format, engine->name, &err);
+  if (!checksumsink->reference) {
+    GST_ELEMENT_ERROR (checksumsink, RESOURCE, OPEN_READ,
+        ("failed to read reference"), ("reason: %s", err->message));
+    g_error_free (err);
+    return FALSE;
+  }
+
+  if (checksumsink->reference->format != checksumsink->reference_format)
+    GST_INFO_OBJECT (checksumsink, "reference index of format %d, "
+        "ignoring reference-format", checksumsink->reference->format);
+  GST_INFO_OBJECT (checksumsink, "%" G_GUINT64_FORMAT " reference frames",
+      gst_cksum_ref_get_n_entries (checksumsink->reference));
+  return index_reference (checksumsink);
+}
+
+/* frames of the reference we never got are reported as missing */
+static void
+clear_reference (GstCksumImageSink * checksumsink)
+{
+  GstCksumRef *ref = checksumsink->reference;
+  guint64 missing;
+
+  if (ref) {
+    if (checksumsink->align_pending)
+      align_reference (checksumsink);
+    if (checksumsink->ref_seen)
+      missing = print_missing_references (checksumsink);
+    else
+      missing = gst_cksum_ref_get_n_entries (ref) - checksumsink->ref_matched;
+    log_printf ("ReferenceMismatches %" G_GUINT64_FORMAT "\n",
+        checksumsink->ref_mismatches);
+    log_printf ("ReferenceMissing %" G_GUINT64_FORMAT "\n", missing);
+    log_printf ("ReferenceExtra %" G_GUINT64_FORMAT "\n",
+        checksumsink->ref_extra);
+  }
+
+  g_clear_pointer (&checksumsink->ref_seen, g_free);
+  g_clear_pointer (&checksumsink->realign_digests, g_ptr_array_unref);
+  g_clear_pointer (&checksumsink->reference, gst_cksum_ref_free);
+  checksumsink->ref_offset = 0;
+  checksumsink->ref_mismatches = 0;
+  checksumsink->ref_matched = 0;
+  checksumsink->ref_extra = 0;
+  checksumsink->reported_frames = 0;
+  checksumsink->header_printed = FALSE;
+}
+
+/* Prints the digests of the @n-th frame in the output format, for each
+ * hash type of @hashes in the default one */
+static void
+write_frame_checksums (GstCksumImageSink * checksumsink, guint64 n,
+    guint hashes,
+    gchar (*plane_csum)[GST_VIDEO_MAX_PLANES][GST_CKSUM_MAX_HEX_SIZE],
+    gchar (*frame_csum)[GST_CKSUM_MAX_HEX_SIZE], guint n_planes)
+{
+  GstCksumHashType primary = get_primary_hash (checksumsink);
+  gchar text[GST_CKSUM_FRAME_TEXT_SIZE];
+
+  switch (checksumsink->output_format) {
+    case GST_CKSUM_REF_FORMAT_FRAMEMD5:
+      print_framemd5 (checksumsink, n, frame_csum[primary]);
+      break;
+    case GST_CKSUM_REF_FORMAT_HM:
+      join_plane_checksums (text, plane_csum[primary], n_planes);
+      log_printf ("POC %4" G_GUINT64_FORMAT " [%s:%s]\n", n,
+          checksumsink->hash_name, text);
+      break;
+    case GST_CKSUM_REF_FORMAT_DEFAULT:
+    default:
+      if (gst_cksum_format_frame_checksums (text, hashes,
+              checksumsink->plane_checksum, checksumsink->frame_checksum,
+              plane_csum, frame_csum, n_planes) > 0)
+        log_puts (text);
+      break;
+  }
+}
+
+/* Compares the digests of a frame with the reference and moves to the
+ * next frame, whether they were printed or not */
+static void
+report_frame_checksums (GstCksumImageSink * checksumsink,
+    gchar (*plane_csum)[GST_VIDEO_MAX_PLANES][GST_CKSUM_MAX_HEX_SIZE],
+    gchar (*frame_csum)[GST_CKSUM_MAX_HEX_SIZE], guint n_planes)
+{
+  GstCksumHashType primary = get_primary_hash (checksumsink);
+
+  check_reference (checksumsink, plane_csum[primary], frame_csum[primary],
+      n_planes);
+  checksumsink->reported_frames++;
+}
+
+static void
+print_frame_checksums (GstCksumImageSink * checksumsink, guint hashes,
+    gchar (*plane_csum)[GST_VIDEO_MAX_PLANES][GST_CKSUM_MAX_HEX_SIZE],
+    gchar (*frame_csum)[GST_CKSUM_MAX_HEX_SIZE], guint n_planes)
+{
+  write_frame_checksums (checksumsink, checksumsink->reported_frames,
+      hashes, plane_csum, frame_csum, n_planes);
+  report_frame_checksums (checksumsink, plane_csum, frame_csum, n_planes);
+}
+
+/* Sets up @walker with the contexts of the hash types computed for each
+ * frame, stored in @types. Returns the number of hash types. */
+static guint
+setup_walker (GstCksumImageSink * checksumsink, GstCksumWalker * walker,
+    GstCksumHashType types[GST_CKSUM_N_HASHES], guint n_planes)
+{
+  guint t, plane, n_types;
+
+  memset (walker, 0, sizeof (GstCksumWalker));
+
+  n_types = get_hash_types (checksumsink, types);
+  for (t = 0; t < n_types; t++) {
+    GstCksumHashType type = types[t];
+
+    if (needs_frame_checksum (checksumsink))
+      walker->frame[t] = get_context (type, &checksumsink->frame_ctx[type]);
+    if (needs_plane_checksum (checksumsink)) {
+      for (plane = 0; plane < n_planes; plane++)
+        walker->plane[plane][t] =
+            get_context (type, &checksumsink->plane_ctx[type][plane]);
+    }
+  }
+  walker->n_hashers = n_types;
+
+  return n_types;
+}
+
+/* Stores the digests of the first @n_types hashers of @walker */
+static void
+finish_walker (GstCksumImageSink * checksumsink, GstCksumWalker * walker,
+    GstCksumHashType types[GST_CKSUM_N_HASHES], guint n_types,
+    guint n_planes)
+{
+  guint t, plane;
+
+  for (t = 0; t < n_types; t++) {
+    GstCksumHashType type = types[t];
+
+    if (walker->frame[t])
+      finish_context (walker->frame[t], checksumsink->frame_csum[type]);
+    for (plane = 0; plane < n_planes; plane++) {
+      if (walker->plane[plane][t])
+        finish_context (walker->plane[plane][t],
+            checksumsink->plane_csum[type][plane]);
+    }
+  }
+}
+
+static void
+print_stream_checksum (GstCksumImageSink * checksumsink)
+{
+  if (checksumsink->stream_frames == 0
+      || checksumsink->stream_printed == checksumsink->stream_frames)
+    return;
+
+  log_printf ("StreamChecksum %" G_GUINT64_FORMAT " %s\n",
+      checksumsink->stream_frames, checksumsink->stream_csum);
+  checksumsink->stream_printed = checksumsink->stream_frames;
+}
+
+/* The stream checksum is the digest of the previous stream checksum
+ * followed by the frame checksum, both as hex strings. */
+static void
+update_stream_checksum (GstCksumImageSink * checksumsink,
+    const gchar * frame_csum)
+{
+  GstCksumHasher *csum;
+  guint interval = checksumsink->stream_checksum_interval;
+
+  if (!checksumsink->stream_checksum)
+    return;
+
+  csum = get_context (get_primary_hash (checksumsink),
+      &checksumsink->stream_ctx);
+  if (checksumsink->stream_frames > 0)
+    gst_cksum_hasher_update (csum, (const guint8 *) checksumsink->stream_csum,
+        strlen (checksumsink->stream_csum));
+  gst_cksum_hasher_update (csum, (const guint8 *) frame_csum,
+      strlen (frame_csum));
+  finish_context (csum, checksumsink->stream_csum);
+  checksumsink->stream_frames++;
+
+  if (interval > 0 && checksumsink->stream_frames % interval == 0)
+    print_stream_checksum (checksumsink);
+}
+
+/* the gate hash only applies to the packed frame of the flat mode */
+static gboolean
+is_gated (GstCksumImageSink * checksumsink)
+{
+  return checksumsink->gate_engine != NULL
+      && checksumsink->digest_mode == GST_CKSUM_DIGEST_MODE_FLAT;
+}
+
+static GstCksumHasher *
+get_gate_context (GstCksumImageSink * checksumsink)
+{
+  GstCksumHashType type = checksumsink->gate_engine->type;
+
+  /* the gate hash may have been changed since the context was created */
+  if (checksumsink->gate_ctx && checksumsink->gate_ctx->engine->type != type)
+    g_clear_pointer (&checksumsink->gate_ctx, gst_cksum_hasher_free);
+
+  return get_context (type, &checksumsink->gate_ctx);
+}
+
+/* Compares the gate digest of the current frame with the reference, if
+ * any. Returns FALSE on mismatch. */
+static gboolean
+check_gate (GstCksumImageSink * checksumsink)
+{
+  GPtrArray *refs = checksumsink->gate_refs;
+  guint64 n = checksumsink->gate_frames++;
+  const gchar *expected;
+
+  if (!refs)
+    return TRUE;
+
+  expected = n < refs->len ? g_ptr_array_index (refs, n) : NULL;
+  if (expected && g_ascii_strcasecmp (expected, checksumsink->gate_csum) == 0)
+    return TRUE;
+
+  GST_WARNING_OBJECT (checksumsink, "gate checksum of frame %"
+      G_GUINT64_FORMAT " is %s, expected %s", n, checksumsink->gate_csum,
+      expected ? expected : "none");
+  log_printf ("GateMismatch %" G_GUINT64_FORMAT " %s\n", n,
+      expected ? expected : "-");
+  checksumsink->gate_mismatches++;
+
+  return FALSE;
+}
+
+/* Moves past a frame that wasn't hashed, so that the following ones are
+ * still compared with their own reference frames */
+static void
+skip_reference (GstCksumImageSink * checksumsink)
+{
+  if (is_gated (checksumsink))
+    checksumsink->gate_frames++;
+
+  if (checksumsink->align_pending) {
+    g_ptr_array_add (checksumsink->align_pending, NULL);
+    if (checksumsink->align_pending->len >= checksumsink->align_window)
+      align_reference (checksumsink);
+  } else if (checksumsink->realign_digests
+      && checksumsink->realign_digests->len > 0) {
+    g_ptr_array_add (checksumsink->realign_digests, NULL);
+  }
+  checksumsink->reported_frames++;
+}
+
+/* Lines holding a single word are expected digests; the GateChecksum
+ * lines printed by the sink are accepted as well, other lines are
+ * ignored. */
+static gboolean
+load_gate_reference (GstCksumImageSink * checksumsink)
+{
+  GError *err = NULL;
+  gchar *contents;
+  gchar **lines, **l;
+
+  if (!checksumsink->gate_reference)
+    return TRUE;
+
+  if (!g_file_get_contents (checksumsink->gate_reference, &contents, NULL,
+          &err)) {
+    GST_ELEMENT_ERROR (checksumsink, RESOURCE, OPEN_READ,
+        ("failed to read gate reference"), ("reason: %s", err->message));
+    g_error_free (err);
+    return FALSE;
+  }
+
+  checksumsink->gate_refs = g_ptr_array_new_with_free_func (g_free);
+  lines = g_strsplit (contents, "\n", -1);
+  for (l = lines; *l; l++) {
+    gchar *hex = g_strstrip (*l);
+
+    if (g_str_has_prefix (hex, "GateChecksum "))
+      hex = g_strchug (hex + strlen ("GateChecksum "));
+    if (*hex && !strchr (hex, ' '))
+      g_ptr_array_add (checksumsink->gate_refs, g_strdup (hex));
+  }
+  g_strfreev (lines);
+  g_free (contents);
+
+  GST_INFO_OBJECT (checksumsink, "%u reference gate checksums",
+      checksumsink->gate_refs->len);
+  return TRUE;
+}
+
+static void
+clear_gate (GstCksumImageSink * checksumsink)
+{
+  GPtrArray *refs = checksumsink->gate_refs;
+
+  if (refs) {
+    /* frames of the reference we never got */
+    if (checksumsink->gate_frames < refs->len)
+      checksumsink->gate_mismatches += refs->len - checksumsink->gate_frames;
+    log_printf ("GateMismatches %" G_GUINT64_FORMAT "\n",
+        checksumsink->gate_mismatches);
+  }
+
+  g_clear_pointer (&checksumsink->gate_refs, g_ptr_array_unref);
+  checksumsink->gate_frames = 0;
+  checksumsink->gate_mismatches = 0;
+  checksumsink->staged_pending = FALSE;
+  gst_buffer_replace (&checksumsink->staged_buffer, NULL);
+}
+
+/* Sets up @planes for the part of @frame that is checksummed and dumped:
+ * the crop rectangle of its buffer, if any, and the planes of the plane
+ * mask. Returns the number of planes. */
+static guint
+init_planes (GstCksumImageSink * checksumsink, GstCksumPlanes * planes,
+    GstVideoFrame * frame)
+{
+  GstVideoCropMeta *crop;
+
+  gst_cksum_planes_init_frame (planes, frame);
+
+  checksumsink->frame_width = GST_VIDEO_FRAME_WIDTH (frame);
+  checksumsink->frame_height = GST_VIDEO_FRAME_HEIGHT (frame);
+
+  crop = gst_buffer_get_video_crop_meta (frame->buffer);
+  if (crop && gst_cksum_planes_crop (planes, &frame->info, crop->x, crop->y,
+          crop->width, crop->height)) {
+    checksumsink->frame_width = crop->width;
+    checksumsink->frame_height = crop->height;
+  } else if (crop) {
+    GST_WARNING_OBJECT (checksumsink, "can't crop to %ux%u at %u,%u, using "
+        "the whole frame", crop->width, crop->height, crop->x, crop->y);
+  }
+
+  return gst_cksum_planes_select (planes, checksumsink->plane_mask);
+}
+
+/* Computes the strong digests of the frame left in the staging buffer */
+static void
+hash_staged_frame (GstCksumImageSink * checksumsink)
+{
+  GstCksumPlanes *staged = &checksumsink->staged;
+  GstCksumHashType types[GST_CKSUM_N_HASHES];
+  GstCksumWalker walker;
+  guint n_types;
+
+  n_types = setup_walker (checksumsink, &walker, types, staged->n_planes);
+  gst_cksum_walk_planes (staged, NULL, &walker);
+  finish_walker (checksumsink, &walker, types, n_types, staged->n_planes);
+
+  checksumsink->staged_pending = FALSE;
+}
+
+/* the strong digests of the last frame are always printed, it was
+ * already reported */
+static void
+flush_staged_frame (GstCksumImageSink * checksumsink)
+{
+  GstVideoFrame frame;
+
+  if (!checksumsink->staged_pending)
+    return;
+
+  /* chunks leave nothing in the staging buffer, read the frame again */
+  if (checksumsink->staged_buffer) {
+    if (!gst_video_frame_map (&frame, &checksumsink->vinfo,
+            checksumsink->staged_buffer, GST_MAP_READ)) {
+      GST_WARNING_OBJECT (checksumsink, "failed to map last frame");
+      checksumsink->staged_pending = FALSE;
+      gst_buffer_replace (&checksumsink->staged_buffer, NULL);
+      return;
+    }
+    init_planes (checksumsink, &checksumsink->staged, &frame);
+    hash_staged_frame (checksumsink);
+    gst_video_frame_unmap (&frame);
+    gst_buffer_replace (&checksumsink->staged_buffer, NULL);
+  } else {
+    hash_staged_frame (checksumsink);
+  }
+  write_frame_checksums (checksumsink, checksumsink->reported_frames - 1,
+      get_hashes (checksumsink), checksumsink->plane_csum,
+      checksumsink->frame_csum, checksumsink->staged.n_planes);
+}
+
+static void
+check_picture_hash (GstCksumImageSink * checksumsink,
+    const DphEntry * expected, const DphEntry * computed)
+{
+  gchar expected_hex[33], computed_hex[33];
+  gboolean mismatch = FALSE;
+  gsize size;
+  guint i;
+
+  if (expected->dph.type != computed->dph.type) {
+    GST_WARNING_OBJECT (checksumsink, "picture hash of %" GST_TIME_FORMAT
+        " is of type %d, computed %d", GST_TIME_ARGS (expected->pts),
+        expected->dph.type, computed->dph.type);
+    checksumsink->dph_unverified++;
+    return;
+  }
+
+  size = gst_cksum_dph_digest_size (expected->dph.type);
+  for (i = 0; i < MIN (expected->dph.n_components,
+          computed->dph.n_components); i++) {
+    if (memcmp (expected->dph.digest[i], computed->dph.digest[i], size) == 0)
+      continue;
+
+    gst_cksum_format_hex (expected->dph.digest[i], size, expected_hex);
+    gst_cksum_format_hex (computed->dph.digest[i], size, computed_hex);
+    GST_WARNING_OBJECT (checksumsink, "picture hash of component %u of %"
+        GST_TIME_FORMAT " is %s, expected %s", i,
+        GST_TIME_ARGS (expected->pts), computed_hex, expected_hex);
+    log_printf ("PictureHashMismatch %" GST_TIME_FORMAT " %u %s %s\n",
+        GST_TIME_ARGS (expected->pts), i, expected_hex, computed_hex);
+    mismatch = TRUE;
+  }
+
+  if (mismatch)
+    checksumsink->dph_mismatches++;
+}
+
+/* Returns an entry for the digests of a picture, recycled from the
+ * matched ones once there are any */
+static DphEntry *
+new_picture_hash (GstCksumImageSink * checksumsink)
+{
+  DphEntry *entry = NULL;
+  GPtrArray *free_entries = checksumsink->dph_free;
+
+  g_mutex_lock (&checksumsink->sei_lock);
+  if (free_entries->len > 0)
+    entry = g_ptr_array_remove_index_fast (free_entries,
+        free_entries->len - 1);
+  g_mutex_unlock (&checksumsink->sei_lock);
+
+  return entry ? entry : g_new (DphEntry, 1);
+}
+
+static void
+recycle_picture_hash (GstCksumImageSink * checksumsink, DphEntry * entry)
+{
+  g_mutex_lock (&checksumsink->sei_lock);
+  g_ptr_array_add (checksumsink->dph_free, entry);
+  g_mutex_unlock (&checksumsink->sei_lock);
+}
+
+/* Moves the entries of @table to the free ones. Must be called with the
+ * sei lock. */
+static void
+recycle_picture_hashes (GstCksumImageSink * checksumsink, GHashTable * table)
+{
+  GHashTableIter iter;
+  gpointer entry;
+
+  g_hash_table_iter_init (&iter, table);
+  while (g_hash_table_iter_next (&iter, NULL, &entry)) {
+    g_ptr_array_add (checksumsink->dph_free, entry);
+    g_hash_table_iter_steal (&iter);
+  }
+}
+
+/* Checks @entry against the one of the same PTS from the other side, or
+ * keeps it until that one comes. Takes ownership of @entry. */
+static void
+match_picture_hash (GstCksumImageSink * checksumsink, DphEntry * entry,
+    gboolean expected)
+{
+  GHashTable *own, *other;
+  DphEntry *match;
+
+  own = expected ? checksumsink->sei_expected : checksumsink->sei_computed;
+  other = expected ? checksumsink->sei_computed : checksumsink->sei_expected;
+
+  g_mutex_lock (&checksumsink->sei_lock);
+  if (expected)
+    checksumsink->dph_type = entry->dph.type;
+
+  match = g_hash_table_lookup (other, &entry->pts);
+  if (match) {
+    check_picture_hash (checksumsink, expected ? entry : match,
+        expected ? match : entry);
+    g_hash_table_steal (other, &entry->pts);
+    g_ptr_array_add (checksumsink->dph_free, match);
+    g_ptr_array_add (checksumsink->dph_free, entry);
+  } else {
+    g_hash_table_replace (own, &entry->pts, entry);
+  }
+  g_mutex_unlock (&checksumsink->sei_lock);
+}
+
+/* Drops the hashes waiting for their other side, which would be matched
+ * with the wrong pictures after a seek */
+static void
+flush_picture_hashes (GstCksumImageSink * checksumsink)
+{
+  g_mutex_lock (&checksumsink->sei_lock);
+  recycle_picture_hashes (checksumsink, checksumsink->sei_expected);
+  recycle_picture_hashes (checksumsink, checksumsink->sei_computed);
+  g_mutex_unlock (&checksumsink->sei_lock);
+}
+
+/* Counts a frame or an access unit that can't be matched for lack of
+ * PTS, which raw streams only get from a container */
+static void
+skip_picture_hash (GstCksumImageSink * checksumsink)
+{
+  gboolean first;
+
+  g_mutex_lock (&checksumsink->sei_lock);
+  first = !checksumsink->dph_no_pts++;
+  checksumsink->dph_unverified++;
+  g_mutex_unlock (&checksumsink->sei_lock);
+
+  if (first)
+    GST_ELEMENT_WARNING (checksumsink, STREAM, FORMAT,
+        ("picture without PTS, can't verify its hash"),
+        ("the access units and frames are matched on their PTS"));
+}
+
+/* frames and access units left unmatched count as unverified */
+static void
+clear_picture_hashes (GstCksumImageSink * checksumsink)
+{
+  g_mutex_lock (&checksumsink->sei_lock);
+  if (checksumsink->sei_pad) {
+    checksumsink->dph_unverified +=
+        g_hash_table_size (checksumsink->sei_expected) +
+        g_hash_table_size (checksumsink->sei_computed);
+    log_printf ("PictureHashMismatches %" G_GUINT64_FORMAT "\n",
+        checksumsink->dph_mismatches);
+    log_printf ("PictureHashesUnverified %" G_GUINT64_FORMAT "\n",
+        checksumsink->dph_unverified);
+  }
+
+  recycle_picture_hashes (checksumsink, checksumsink->sei_expected);
+  recycle_picture_hashes (checksumsink, checksumsink->sei_computed);
+  checksumsink->dph_type = GST_CKSUM_DPH_MD5;
+  checksumsink->dph_mismatches = 0;
+  checksumsink->dph_unverified = 0;
+  checksumsink->dph_no_pts = 0;
+  g_mutex_unlock (&checksumsink->sei_lock);
+}
+
+/* Returns the hashers of the components of @frame for the digest type
+ * last seen in the access units, MD5 until then, or NULL if the frame
+ * can't be verified */
+static GstCksumHasher **
+get_picture_hashers (GstCksumImageSink * checksumsink, GstVideoFrame * frame,
+    GstCksumDphType * type, guint * n_components)
+{
+  GstCksumHasher **ctx;
+  guint i;
+
+  if (!checksumsink->sei_pad)
+    return NULL;
+  if (!GST_BUFFER_PTS_IS_VALID (frame->buffer)) {
+    skip_picture_hash (checksumsink);
+    return NULL;
+  }
+  if (!gst_cksum_dph_supports_format (&frame->info))
+    return NULL;
+
+  g_mutex_lock (&checksumsink->sei_lock);
+  *type = checksumsink->dph_type;
+  g_mutex_unlock (&checksumsink->sei_lock);
+
+  ctx = checksumsink->dph_ctx[*type];
+  *n_components = MIN (GST_VIDEO_FRAME_N_COMPONENTS (frame),
+      GST_CKSUM_DPH_MAX_COMPONENTS);
+  for (i = 0; i < *n_components; i++) {
+    if (ctx[i])
+      gst_cksum_hasher_reset (ctx[i]);
+    else
+      ctx[i] = gst_cksum_dph_hasher_new (*type, &frame->info);
+  }
+
+  return ctx;
+}
+
+/* Feeds the components of the whole decoded picture to @ctx, for when
+ * the checksummed planes are cropped or masked */
+static void
+walk_picture (GstVideoFrame * frame, GstCksumHasher ** ctx,
+    guint n_components)
+{
+  GstCksumWalker walker;
+  GstCksumPlanes planes;
+  guint i;
+
+  memset (&walker, 0, sizeof (GstCksumWalker));
+  for (i = 0; i < n_components; i++)
+    walker.plane[i][0] = ctx[i];
+  walker.n_hashers = 1;
+
+  gst_cksum_planes_init_frame (&planes, frame);
+  planes.n_planes = n_components;
+  gst_cksum_walk_planes (&planes, NULL, &walker);
+}
+
+static void
+finish_picture_hashers (GstCksumImageSink * checksumsink,
+    GstVideoFrame * frame, GstCksumHasher ** ctx, GstCksumDphType type,
+    guint n_components)
+{
+  DphEntry *entry = new_picture_hash (checksumsink);
+  guint i;
+
+  entry->pts = GST_BUFFER_PTS (frame->buffer);
+  entry->dph.type = type;
+  entry->dph.n_components = n_components;
+  for (i = 0; i < n_components; i++)
+    gst_cksum_hasher_final (ctx[i], entry->dph.digest[i]);
+
+  match_picture_hash (checksumsink, entry, FALSE);
+}
+
+static GstFlowReturn
+gst_cksum_image_sink_sei_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (parent);
+  GstMapInfo info;
+  DphEntry *entry;
+
+  if (!GST_BUFFER_PTS_IS_VALID (buffer))
+    skip_picture_hash (checksumsink);
+  else if (gst_buffer_map (buffer, &info, GST_MAP_READ)) {
+    entry = new_picture_hash (checksumsink);
+    entry->pts = GST_BUFFER_PTS (buffer);
+    if (gst_cksum_dph_parse (info.data, info.size, checksumsink->sei_vvc,
+            checksumsink->sei_rbsp, &entry->dph))
+      match_picture_hash (checksumsink, entry, TRUE);
+    else
+      recycle_picture_hash (checksumsink, entry);
+    gst_buffer_unmap (buffer, &info);
+  }
+
+  gst_buffer_unref (buffer);
+  return GST_FLOW_OK;
+}
+
+/* nothing is rendered from the access units, their events are only
+ * looked at for the codec and flushes */
+static gboolean
+gst_cksum_image_sink_sei_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (parent);
+  GstCaps *caps;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+      gst_event_parse_caps (event, &caps);
+      checksumsink->sei_vvc =
+          gst_structure_has_name (gst_caps_get_structure (caps, 0),
+          "video/x-h266");
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      flush_picture_hashes (checksumsink);
+      break;
+    default:
+      break;
+  }
+
+  gst_event_unref (event);
+  return TRUE;
+}
+
+static GstPad *
+gst_cksum_image_sink_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (element);
+  GstPad *pad;
+
+  GST_OBJECT_LOCK (checksumsink);
+  if (checksumsink->sei_pad) {
+    GST_OBJECT_UNLOCK (checksumsink);
+    GST_WARNING_OBJECT (checksumsink, "there is already a sei pad");
+    return NULL;
+  }
+  pad = gst_pad_new_from_template (templ, "sei");
+  gst_pad_set_chain_function (pad,
+      GST_DEBUG_FUNCPTR (gst_cksum_image_sink_sei_chain));
+  gst_pad_set_event_function (pad,
+      GST_DEBUG_FUNCPTR (gst_cksum_image_sink_sei_event));
+  checksumsink->sei_pad = pad;
+  GST_OBJECT_UNLOCK (checksumsink);
+
+  gst_element_add_pad (element, pad);
+  return pad;
+}
+
+static void
+gst_cksum_image_sink_release_pad (GstElement * element, GstPad * pad)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (element);
+
+  GST_OBJECT_LOCK (checksumsink);
+  if (checksumsink->sei_pad == pad)
+    checksumsink->sei_pad = NULL;
+  GST_OBJECT_UNLOCK (checksumsink);
+
+  gst_element_remove_pad (element, pad);
+}
+
+static void
+clear_stream_checksum (GstCksumImageSink * checksumsink)
+{
+  checksumsink->stream_csum[0] = '\0';
+  checksumsink->stream_frames = 0;
+  checksumsink->stream_printed = 0;
+}
+
+/* the inter-arrival @mean and @m2 are the ones of @n_deltas intervals */
+static void
+print_throughput (GstCksumImageSink * checksumsink, const gchar * what,
+    guint64 frames, guint64 bytes, gint64 elapsed, guint64 n_deltas,
+    gdouble mean, gdouble m2)
+{
+  gdouble secs = elapsed / (gdouble) G_USEC_PER_SEC;
+  gdouble jitter = 0;
+
+  if (secs <= 0)
+    return;
+  if (n_deltas > 1)
+    jitter = sqrt (m2 / (n_deltas - 1)) / 1000.0;
+
+  log_printf ("%s: frames %" G_GUINT64_FORMAT " fps %.2f bytes/s %.0f "
+      "interval %.3f ms jitter %.3f ms\n", what, frames, frames / secs,
+      bytes / secs, mean / 1000.0, jitter);
+}
+
+/* Accounts the arrival of @buffer, reading a byte of every page of it
+ * first if requested so that the time includes the readback. */
+static void
+update_throughput (GstCksumImageSink * checksumsink, GstBuffer * buffer)
+{
+  GstCksumThroughput *tp = &checksumsink->throughput;
+  gsize size = gst_buffer_get_size (buffer);
+  gint64 now;
+
+  if (!checksumsink->measure_throughput)
+    return;
+
+  if (checksumsink->touch_pages) {
+    GstMapInfo info;
+    volatile guint8 sum = 0;
+    gsize i;
+
+    if (gst_buffer_map (buffer, &info, GST_MAP_READ)) {
+      for (i = 0; i < info.size; i += PAGE_SIZE_TOUCH)
+        sum += info.data[i];
+      gst_buffer_unmap (buffer, &info);
+    }
+    (void) sum;
+  }
+
+  now = g_get_monotonic_time ();
+
+  if (tp->frames == 0) {
+    tp->start = tp->report_time = now;
+  } else {
+    gdouble delta = now - tp->last;
+    gdouble d = delta - tp->mean;
+
+    tp->mean += d / tp->frames;
+    tp->m2 += d * (delta - tp->mean);
+
+    d = delta - tp->report_mean;
+    tp->report_deltas++;
+    tp->report_mean += d / tp->report_deltas;
+    tp->report_m2 += d * (delta - tp->report_mean);
+  }
+  tp->last = now;
+  tp->frames++;
+  tp->bytes += size;
+
+  if (checksumsink->report_interval > 0
+      && now - tp->report_time >=
+      (gint64) checksumsink->report_interval * 1000) {
+    print_throughput (checksumsink, "Throughput",
+        tp->frames - tp->report_frames, tp->bytes - tp->report_bytes,
+        now - tp->report_time, tp->report_deltas, tp->report_mean,
+        tp->report_m2);
+    tp->report_time = now;
+    tp->report_frames = tp->frames;
+    tp->report_bytes = tp->bytes;
+    tp->report_deltas = 0;
+    tp->report_mean = 0;
+    tp->report_m2 = 0;
+  }
+}
+
+static gboolean
+open_raw_file (GstCksumImageSink * checksumsink)
+{
+  GError *err = NULL;
+
+  if (!checksumsink->file_checksum && !checksumsink->dump_output)
+    return TRUE;
+
+  if (checksumsink->fd != -1)
+    return TRUE;
+  else if (checksumsink->raw_file_name)
+    checksumsink->fd = g_open (checksumsink->raw_file_name, O_WRONLY | O_CREAT,
+        S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+  else
     checksumsink->fd =
         g_file_open_tmp ("tmp_XXXXXX.yuv", &checksumsink->raw_file_name, &err);
 
-  if (checksumsink->fd == -1) {
-    GST_ELEMENT_ERROR (checksumsink, RESOURCE, OPEN_WRITE,
-        ("failed to create output file"),
-        ("reason: %s", err ? err->message : ""));
-    g_error_free (err);
-    return FALSE;
+  if (checksumsink->fd == -1) {
+    GST_ELEMENT_ERROR (checksumsink, RESOURCE, OPEN_WRITE,
+        ("failed to create output file"),
+        ("reason: %s", err ? err->message : g_strerror (errno)));
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  checksumsink->written = 0;
+  checksumsink->synced = 0;
+
+  GST_INFO_OBJECT (checksumsink, "raw file name: %s",
+      checksumsink->raw_file_name);
+  return TRUE;
+}
+
+static gpointer
+sync_raw_file_func (gpointer data)
+{
+  gint fd = GPOINTER_TO_INT (data);
+
+  fsync (fd);
+  close (fd);
+
+  return NULL;
+}
+
+static void
+close_raw_file (GstCksumImageSink * checksumsink)
+{
+  gint fd = checksumsink->fd;
+  GThread *thread;
+
+  if (fd == -1)
+    return;
+  checksumsink->fd = -1;
+
+  /* nothing to make durable when the file is removed right away */
+  if (!checksumsink->dump_output) {
+    close (fd);
+    return;
+  }
+
+  switch (checksumsink->sync_mode) {
+    case GST_CKSUM_SYNC_MODE_SYNC:
+      fsync (fd);
+      close (fd);
+      break;
+    case GST_CKSUM_SYNC_MODE_ASYNC:
+      /* the thread owns the descriptor from now on */
+      thread = g_thread_try_new ("cksumsync", sync_raw_file_func,
+          GINT_TO_POINTER (fd), NULL);
+      if (thread)
+        g_thread_unref (thread);
+      else
+        sync_raw_file_func (GINT_TO_POINTER (fd));
+      break;
+    case GST_CKSUM_SYNC_MODE_NONE:
+    default:
+      close (fd);
+      break;
+  }
+}
+
+/* the processing deadline exists since GStreamer 1.16, before which the
+ * processing time is left out of the latency */
+static GstClockTime
+get_processing_deadline (GstCksumImageSink * checksumsink)
+{
+#if GST_CHECK_VERSION (1, 16, 0)
+  return gst_base_sink_get_processing_deadline (GST_BASE_SINK (checksumsink));
+#else
+  return 0;
+#endif
+}
+
+static void
+set_processing_deadline (GstCksumImageSink * checksumsink,
+    GstClockTime deadline)
+{
+#if GST_CHECK_VERSION (1, 16, 0)
+  gst_base_sink_set_processing_deadline (GST_BASE_SINK (checksumsink),
+      deadline);
+#endif
+}
+
+static gboolean
+gst_cksum_image_sink_start (GstBaseSink * sink)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
+
+  if (!open_raw_file (checksumsink))
+    return FALSE;
+  if (!load_gate_reference (checksumsink))
+    return FALSE;
+  if (!load_reference (checksumsink))
+    return FALSE;
+
+  if (checksumsink->chunk_size > 0
+      && checksumsink->digest_mode != GST_CKSUM_DIGEST_MODE_FLAT)
+    GST_WARNING_OBJECT (checksumsink, "chunk-size only applies to the flat "
+        "digest mode, staging whole frames");
+  if (checksumsink->plane_mask != ALL_PLANES
+      && checksumsink->digest_mode != GST_CKSUM_DIGEST_MODE_FLAT)
+    GST_WARNING_OBJECT (checksumsink, "plane-mask only applies to the flat "
+        "digest mode, using all planes");
+  if (checksumsink->sei_pad
+      && checksumsink->digest_mode != GST_CKSUM_DIGEST_MODE_FLAT)
+    GST_WARNING_OBJECT (checksumsink, "decoded picture hashes are only "
+        "verified in the flat digest mode");
+
+  checksumsink->frame_num = 0;
+  checksumsink->time_offset = 0;
+  checksumsink->seek_done = FALSE;
+  checksumsink->seek_pending = FALSE;
+  checksumsink->proc_time = 0;
+  checksumsink->proc_jitter = 0;
+
+  /* restored at stop, for when live-monitor is turned off */
+  checksumsink->monitoring = checksumsink->live_monitor;
+  if (checksumsink->monitoring) {
+    checksumsink->saved_sync = gst_base_sink_get_sync (sink);
+    checksumsink->saved_qos = gst_base_sink_is_qos_enabled (sink);
+    gst_base_sink_set_sync (sink, TRUE);
+    gst_base_sink_set_qos_enabled (sink, TRUE);
+    set_processing_deadline (checksumsink, 0);
+  }
+
+  if (checksumsink->async_hashing && !start_worker (checksumsink))
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+checksum_raw_file (GstCksumImageSink * checksumsink)
+{
+  gchar hex[GST_CKSUM_MAX_HEX_SIZE];
+  GError *err = NULL;
+  gboolean ret;
+
+  if (!checksumsink->file_checksum)
+    return TRUE;
+  if (!checksumsink->raw_file_name) {
+    GST_WARNING_OBJECT (checksumsink, "unspecified raw file");
+    return FALSE;
+  }
+
+  ret = gst_cksum_hash_file (checksumsink->raw_file_name,
+      checksumsink->file_hash, get_n_threads (checksumsink), hex, &err);
+  if (ret) {
+    log_printf ("%s\n", hex);
+  } else {
+    GST_WARNING_OBJECT (checksumsink, "%s", err->message);
+    g_error_free (err);
+  }
+
+  /* don't remove if we expect to keep the raw output */
+  if (!checksumsink->dump_output && g_unlink (checksumsink->raw_file_name) != 0) {
+    GST_WARNING_OBJECT (checksumsink, "failed to remove %s: %s",
+        checksumsink->raw_file_name, strerror (errno));
+  }
+
+  return ret;
+}
+
+static gboolean
+gst_cksum_image_sink_stop (GstBaseSink * sink)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
+
+  /* hashes whatever is still queued */
+  stop_worker (checksumsink);
+
+  /* in case the stream ended without EOS */
+  flush_staged_frame (checksumsink);
+  print_stream_checksum (checksumsink);
+  clear_stream_checksum (checksumsink);
+  clear_gate (checksumsink);
+  clear_picture_hashes (checksumsink);
+  clear_reference (checksumsink);
+
+  if (checksumsink->measure_throughput && checksumsink->throughput.frames) {
+    GstCksumThroughput *tp = &checksumsink->throughput;
+
+    print_throughput (checksumsink, "TotalThroughput", tp->frames, tp->bytes,
+        tp->last - tp->start, tp->frames - 1, tp->mean, tp->m2);
+  }
+  memset (&checksumsink->throughput, 0, sizeof (GstCksumThroughput));
+
+  if (checksumsink->n_skipped > 0) {
+    log_printf ("SkippedFrames %" G_GUINT64_FORMAT "\n", checksumsink->n_skipped);
+    checksumsink->n_skipped = 0;
+  }
+
+  close_raw_file (checksumsink);
+
+  checksum_raw_file (checksumsink);
+
+  if (checksumsink->monitoring) {
+    gst_base_sink_set_sync (sink, checksumsink->saved_sync);
+    gst_base_sink_set_qos_enabled (sink, checksumsink->saved_qos);
+    checksumsink->monitoring = FALSE;
+  }
+
+  g_clear_pointer (&checksumsink->raw_file_name, g_free);
+
+  free_data (checksumsink);
+
+  clear_digest_cache (checksumsink);
+  clear_tiles (checksumsink);
+  clear_contexts (checksumsink);
+
+  if (checksumsink->pool) {
+    g_thread_pool_free (checksumsink->pool, FALSE, TRUE);
+    checksumsink->pool = NULL;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_cksum_image_sink_event (GstBaseSink * sink, GstEvent * event)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      drain_worker (checksumsink);
+      flush_staged_frame (checksumsink);
+      print_stream_checksum (checksumsink);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      if (checksumsink->seek_pending) {
+        GstVideoInfo *vinfo = &checksumsink->vinfo;
+
+        /* number frames and running times as if we had not seeked */
+        checksumsink->time_offset = checksumsink->seek_time;
+        if (GST_VIDEO_INFO_FPS_N (vinfo) > 0)
+          checksumsink->frame_num =
+              gst_util_uint64_scale_round (checksumsink->seek_time,
+              GST_VIDEO_INFO_FPS_N (vinfo),
+              GST_VIDEO_INFO_FPS_D (vinfo) * GST_SECOND);
+        checksumsink->seek_pending = FALSE;
+      }
+      flush_picture_hashes (checksumsink);
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+}
+
+static gboolean
+gst_cksum_image_sink_set_caps (GstBaseSink * base_sink, GstCaps * caps)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (base_sink);
+  GstVideoInfo vinfo;
+  guint8 *data;
+
+  if (!caps)
+    return FALSE;
+  if (!gst_video_info_from_caps (&vinfo, caps))
+    return FALSE;
+  update_hash_name (checksumsink);
+
+  if (checksumsink->digest_mode == GST_CKSUM_DIGEST_MODE_FLAT
+      && !(checksumsink->plane_mask
+          & ((1 << GST_VIDEO_INFO_N_PLANES (&vinfo)) - 1))) {
+    GST_ELEMENT_ERROR (checksumsink, RESOURCE, SETTINGS,
+        ("plane-mask 0x%x selects none of the %u planes of %s",
+            checksumsink->plane_mask, GST_VIDEO_INFO_N_PLANES (&vinfo),
+            gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (&vinfo))),
+        (NULL));
+    return FALSE;
+  }
+
+  /* queued frames are hashed with the previous caps */
+  drain_worker (checksumsink);
+
+  checksumsink->vinfo = vinfo;
+  checksumsink->frame_width = GST_VIDEO_INFO_WIDTH (&vinfo);
+  checksumsink->frame_height = GST_VIDEO_INFO_HEIGHT (&vinfo);
+  clear_digest_cache (checksumsink);
+  clear_tiles (checksumsink);
+  clear_picture_hashers (checksumsink);
+
+  if (checksumsink->sei_pad && !gst_cksum_dph_supports_format (&vinfo))
+    GST_WARNING_OBJECT (checksumsink, "decoded picture hashes can't be "
+        "verified on %s frames", gst_video_format_to_string
+        (GST_VIDEO_INFO_FORMAT (&vinfo)));
+
+  /* fault the staging buffer in now rather than on the first frame */
+  if (needs_pixels (checksumsink)
+      && (data = alloc_data (checksumsink,
+              get_staging_size (checksumsink, &vinfo))))
+    memset (data, 0, checksumsink->data_size);
+
+  return TRUE;
+}
+
+static gboolean
+gst_cksum_image_sink_propose_allocation (GstBaseSink * base_sink,
+    GstQuery * query)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (base_sink);
+
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+  /* the tiles are laid out on the whole frame */
+  if (checksumsink->digest_mode == GST_CKSUM_DIGEST_MODE_FLAT)
+    gst_query_add_allocation_meta (query, GST_VIDEO_CROP_META_API_TYPE, NULL);
+  return TRUE;
+}
+
+/* Maps @size bytes of anonymous memory aligned on huge pages, so that
+ * all of it can be backed by them. Explicit huge pages come from the
+ * hugetlbfs pool, which is usually empty unless reserved. */
+static guint8 *
+map_huge_pages (GstCksumImageSink * checksumsink, gsize size, gsize * mapped)
+{
+  gsize len = GST_ROUND_UP_N (size, HUGE_PAGE_SIZE);
+  gsize head;
+  guint8 *map;
+
+#ifdef MAP_HUGETLB
+  if (checksumsink->huge_pages == GST_CKSUM_HUGE_PAGES_EXPLICIT) {
+    map = mmap (NULL, len, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (map != MAP_FAILED) {
+      *mapped = len;
+      return map;
+    }
+    GST_INFO_OBJECT (checksumsink, "no explicit huge pages (%s), "
+        "falling back to transparent ones", g_strerror (errno));
+  }
+#endif
+
+  map = mmap (NULL, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED) {
+    GST_WARNING_OBJECT (checksumsink, "failed to map %" G_GSIZE_FORMAT
+        " bytes: %s", len, g_strerror (errno));
+    return NULL;
+  }
+
+  /* trim the mapping to start on a huge page boundary */
+  head = GST_ROUND_UP_N (GPOINTER_TO_SIZE (map), HUGE_PAGE_SIZE)
+      - GPOINTER_TO_SIZE (map);
+  if (head > 0)
+    munmap (map, head);
+  if (head < HUGE_PAGE_SIZE)
+    munmap (map + head + len, HUGE_PAGE_SIZE - head);
+  map += head;
+
+#ifdef MADV_HUGEPAGE
+  madvise (map, len, MADV_HUGEPAGE);
+#endif
+
+  *mapped = len;
+  return map;
+}
+
+static void
+free_data (GstCksumImageSink * checksumsink)
+{
+  if (checksumsink->data_mapped)
+    munmap (checksumsink->data, checksumsink->data_mapped);
+  else
+    g_free (checksumsink->data);
+
+  checksumsink->data = NULL;
+  checksumsink->data_size = 0;
+  checksumsink->data_mapped = 0;
+}
+
+static guint8 *
+alloc_data (GstCksumImageSink * checksumsink, gsize size)
+{
+  guint8 *data = NULL;
+  gsize mapped = 0;
+
+  if (checksumsink->data && checksumsink->data_size == size)
+    return checksumsink->data;
+
+  if (checksumsink->data) {
+    clear_tiles (checksumsink);
+    free_data (checksumsink);
+  }
+
+  if (size == 0)
+    return NULL;
+
+  if (checksumsink->huge_pages != GST_CKSUM_HUGE_PAGES_NONE)
+    data = map_huge_pages (checksumsink, size, &mapped);
+  if (!data)
+    data = g_malloc (size);
+
+  checksumsink->data = data;
+  checksumsink->data_size = size;
+  checksumsink->data_mapped = mapped;
+
+  return data;
+}
+
+/* Returns the single memory backing @buffer if it can be used as a key
+ * for the digest cache. Its contents are never looked at: buffers of a
+ * pool are refilled in place once released, so only the memory of
+ * buffers outside of any pool is trusted to keep its contents. */
+static GstMemory *
+get_cacheable_memory (GstCksumImageSink * checksumsink, GstBuffer * buffer)
+{
+  if (!checksumsink->cache_digests)
+    return NULL;
+  /* the digests are all we keep, not the pixels or leaves */
+  if (checksumsink->file_checksum || checksumsink->dump_output
+      || checksumsink->log_leaves)
+    return NULL;
+  /* gated frames are checked against the reference by position */
+  if (is_gated (checksumsink))
+    return NULL;
+  /* and each frame against the picture hash of its access unit */
+  if (checksumsink->sei_pad)
+    return NULL;
+  if (buffer->pool || gst_buffer_n_memory (buffer) != 1)
+    return NULL;
+
+  return gst_buffer_peek_memory (buffer, 0);
+}
+
+static gboolean
+print_cached_digest (GstCksumImageSink * checksumsink, GstMemory * mem)
+{
+  GstCksumDigestCache *cache = &checksumsink->cache;
+
+  if (!mem || cache->mem != mem || cache->offset != mem->offset
+      || cache->size != mem->size)
+    return FALSE;
+  if (cache->hashes != get_hashes (checksumsink))
+    return FALSE;
+  if (needs_plane_checksum (checksumsink) && cache->n_planes == 0)
+    return FALSE;
+  if (needs_frame_checksum (checksumsink)
+      && !cache->frame_csum[get_primary_hash (checksumsink)][0])
+    return FALSE;
+
+  GST_CAT_DEBUG_OBJECT (CAT_PERFORMANCE, checksumsink,
+      "memory %p pushed again, reusing digest", mem);
+
+  print_frame_checksums (checksumsink, cache->hashes, cache->plane_csum,
+      cache->frame_csum, cache->n_planes);
+
+  update_stream_checksum (checksumsink,
+      cache->frame_csum[get_primary_hash (checksumsink)]);
+
+  return TRUE;
+}
+
+static void
+setup_tiles (GstCksumImageSink * checksumsink, GstVideoFrame * frame)
+{
+  guint plane, n_planes, n_tiles, i;
+  gint x, y, w, h, tw, th;
+  gsize offset;
+
+  n_planes = GST_VIDEO_FRAME_N_PLANES (frame);
+  if (checksumsink->digest_mode == GST_CKSUM_DIGEST_MODE_STRIPES)
+    th = checksumsink->stripe_height;
+  else
+    th = checksumsink->tile_size;
+
+  for (i = 0; i < 2; i++) {
+    n_tiles = 0;
+    offset = 0;
+
+    for (plane = 0; plane < n_planes; plane++) {
+      w = gst_cksum_plane_row_size (&frame->info, plane);
+      h = GST_VIDEO_FRAME_COMP_HEIGHT (frame, plane);
+      if (checksumsink->digest_mode == GST_CKSUM_DIGEST_MODE_STRIPES)
+        tw = w;
+      else
+        tw = checksumsink->tile_size * GST_VIDEO_FRAME_COMP_PSTRIDE (frame,
+            plane);
+      if (tw == 0 || tw > w)
+        tw = w;
+
+      for (y = 0; y < h; y += th) {
+        for (x = 0; x < w; x += tw) {
+          if (checksumsink->tiles) {
+            GstCksumTile *tile = &checksumsink->tiles[n_tiles];
+
+            tile->plane = plane;
+            tile->x = x;
+            tile->y = y;
+            tile->width = MIN (tw, w - x);
+            tile->height = MIN (th, h - y);
+            tile->offset = offset + (gsize) y * w + x;
+            tile->stride = w;
+            tile->csum = gst_cksum_hasher_new (get_primary_hash (checksumsink));
+          }
+          n_tiles++;
+        }
+      }
+      offset += (gsize) w * h;
+    }
+
+    /* first pass counts the tiles, second one fills them */
+    if (!checksumsink->tiles) {
+      checksumsink->tiles = g_new0 (GstCksumTile, n_tiles);
+      checksumsink->tree_nodes = g_new (guint8,
+          (gsize) n_tiles * GST_CKSUM_MAX_DIGEST_SIZE);
+    }
+  }
+
+  checksumsink->n_tiles = n_tiles;
+  checksumsink->tiles_size = offset;
+  checksumsink->tiles_valid = FALSE;
+
+  GST_DEBUG_OBJECT (checksumsink, "%u leaves of %d rows", n_tiles, th);
+}
+
+#define TREE_NODE(nodes, i) ((nodes) + (gsize) (i) * GST_CKSUM_MAX_DIGEST_SIZE)
+
+/* Writes into @hex the root of the binary hash tree whose leaves are the
+ * digests of the tiles of @plane, or of all of them if @plane is -1, in
+ * layout order. Each node is the @csum digest of its two children, or of
+ * its only child at the end of an odd level, so that a single leaf is
+ * hashed once as well. */
+static void
+compute_tiles_root (GstCksumImageSink * checksumsink, GstCksumHasher * csum,
+    gint plane, gchar * hex)
+{
+  guint8 *nodes = checksumsink->tree_nodes;
+  gsize len =
+      gst_cksum_engine_get (get_primary_hash (checksumsink))->digest_size;
+  guint i, n = 0;
+
+  for (i = 0; i < checksumsink->n_tiles; i++) {
+    GstCksumTile *tile = &checksumsink->tiles[i];
+
+    if (plane < 0 || tile->plane == plane)
+      memcpy (TREE_NODE (nodes, n++), tile->digest, len);
+  }
+
+  if (n == 0) {
+    finish_context (csum, hex);
+    return;
+  }
+
+  /* each level is written over the start of the previous one */
+  do {
+    for (i = 0; i < n; i += 2) {
+      gst_cksum_hasher_reset (csum);
+      gst_cksum_hasher_update (csum, TREE_NODE (nodes, i), len);
+      if (i + 1 < n)
+        gst_cksum_hasher_update (csum, TREE_NODE (nodes, i + 1), len);
+      gst_cksum_hasher_final (csum, TREE_NODE (nodes, i / 2));
+    }
+    n = (n + 1) / 2;
+    len = csum->engine->digest_size;
+  } while (n > 1);
+
+  gst_cksum_engine_format (csum->engine, nodes, hex);
+}
+
+/* Copies @tile of @frame into the staging buffer @data and hashes it.
+ * In tiles mode, tiles that did not change since the previous frame are
+ * neither copied nor rehashed. */
+static void
+hash_tile (GstCksumImageSink * checksumsink, GstVideoFrame * frame,
+    guint8 * data, GstCksumTile * tile)
+{
+  GstCksumHasher *csum;
+  gint ps = GST_VIDEO_FRAME_PLANE_STRIDE (frame, tile->plane);
+  const guint8 *sp = GST_VIDEO_FRAME_PLANE_DATA (frame, tile->plane);
+  guint8 *dp = data + tile->offset;
+  guint j;
+
+  tile->dirty = !checksumsink->tiles_valid
+      || checksumsink->digest_mode != GST_CKSUM_DIGEST_MODE_TILES;
+
+  sp += (gsize) tile->y * ps + tile->x;
+  for (j = 0; j < tile->height; j++) {
+    /* once a row differs, the rest of the tile is copied unchecked */
+    if (tile->dirty || memcmp (dp, sp, tile->width) != 0) {
+      memcpy (dp, sp, tile->width);
+      tile->dirty = TRUE;
+    }
+    sp += ps;
+    dp += tile->stride;
+  }
+
+  if (!tile->dirty)
+    return;
+
+  csum = tile->csum;
+  gst_cksum_hasher_reset (csum);
+  dp = data + tile->offset;
+  for (j = 0; j < tile->height; j++) {
+    gst_cksum_hasher_update (csum, dp, tile->width);
+    dp += tile->stride;
+  }
+  gst_cksum_hasher_final (csum, tile->digest);
+}
+
+static void
+hash_tile_func (gpointer data, gpointer user_data)
+{
+  GstCksumImageSink *checksumsink = user_data;
+
+  hash_tile (checksumsink, checksumsink->pool_frame, checksumsink->pool_data,
+      data);
+
+  g_mutex_lock (&checksumsink->pool_lock);
+  if (--checksumsink->pool_pending == 0)
+    g_cond_signal (&checksumsink->pool_cond);
+  g_mutex_unlock (&checksumsink->pool_lock);
+}
+
+static gboolean
+hash_tiles_parallel (GstCksumImageSink * checksumsink, GstVideoFrame * frame,
+    guint8 * data)
+{
+  GError *err = NULL;
+  guint i;
+
+  if (!checksumsink->pool) {
+    checksumsink->pool = g_thread_pool_new (hash_tile_func, checksumsink,
+        get_n_threads (checksumsink), FALSE, &err);
+    if (!checksumsink->pool) {
+      GST_WARNING_OBJECT (checksumsink, "failed to create thread pool: %s",
+          err->message);
+      g_error_free (err);
+      return FALSE;
+    }
+  }
+
+  checksumsink->pool_frame = frame;
+  checksumsink->pool_data = data;
+  checksumsink->pool_pending = checksumsink->n_tiles;
+
+  for (i = 0; i < checksumsink->n_tiles; i++)
+    g_thread_pool_push (checksumsink->pool, &checksumsink->tiles[i], NULL);
+
+  g_mutex_lock (&checksumsink->pool_lock);
+  while (checksumsink->pool_pending > 0)
+    g_cond_wait (&checksumsink->pool_cond, &checksumsink->pool_lock);
+  g_mutex_unlock (&checksumsink->pool_lock);
+
+  checksumsink->pool_frame = NULL;
+  checksumsink->pool_data = NULL;
+
+  return TRUE;
+}
+
+static void
+print_leaves (GstCksumImageSink * checksumsink)
+{
+  gsize digest_len =
+      gst_cksum_engine_get (get_primary_hash (checksumsink))->digest_size;
+  gchar hex[GST_CKSUM_MAX_HEX_SIZE];
+  guint i;
+
+  for (i = 0; i < checksumsink->n_tiles; i++) {
+    GstCksumTile *tile = &checksumsink->tiles[i];
+
+    gst_cksum_format_hex (tile->digest, digest_len, hex);
+    log_printf ("Leaf %u %d %d %s\n", tile->plane, tile->x, tile->y, hex);
+  }
+}
+
+/* Hashes every tile (or stripe) of @frame, in parallel unless a single
+ * thread is requested. Plane and frame checksums are the roots of the
+ * hash trees of their leaves. Returns the size of the packed frame. */
+static gsize
+hash_tiles (GstCksumImageSink * checksumsink, GstVideoFrame * frame,
+    guint8 * data)
+{
+  GstCksumHashType types[GST_CKSUM_N_HASHES];
+  guint i, t, plane, n_dirty, n_types;
+
+  if (!checksumsink->tiles)
+    setup_tiles (checksumsink, frame);
+
+  if (get_n_threads (checksumsink) < 2 || checksumsink->n_tiles < 2
+      || !hash_tiles_parallel (checksumsink, frame, data)) {
+    for (i = 0; i < checksumsink->n_tiles; i++)
+      hash_tile (checksumsink, frame, data, &checksumsink->tiles[i]);
+  }
+
+  checksumsink->tiles_valid = TRUE;
+
+  n_dirty = 0;
+  for (i = 0; i < checksumsink->n_tiles; i++)
+    n_dirty += checksumsink->tiles[i].dirty;
+  GST_CAT_DEBUG_OBJECT (CAT_PERFORMANCE, checksumsink,
+      "hashed %u of %u leaves", n_dirty, checksumsink->n_tiles);
+
+  if (checksumsink->log_leaves)
+    print_leaves (checksumsink);
+
+  /* the trees are built with each hash type over the leaf digests */
+  n_types = get_hash_types (checksumsink, types);
+  for (t = 0; t < n_types; t++) {
+    GstCksumHashType type = types[t];
+
+    if (needs_plane_checksum (checksumsink)) {
+      for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (frame); plane++)
+        compute_tiles_root (checksumsink,
+            get_context (type, &checksumsink->plane_ctx[type][plane]), plane,
+            checksumsink->plane_csum[type][plane]);
+    }
+    if (needs_frame_checksum (checksumsink))
+      compute_tiles_root (checksumsink,
+          get_context (type, &checksumsink->frame_ctx[type]), -1,
+          checksumsink->frame_csum[type]);
   }
 
-  GST_INFO_OBJECT (checksumsink, "raw file name: %s",
-      checksumsink->raw_file_name);
-  return TRUE;
+  return checksumsink->tiles_size;
 }
 
 static gboolean
-gst_cksum_image_sink_start (GstBaseSink * sink)
+ranges_contain (GArray * ranges, guint64 value)
 {
-  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
+  guint i;
 
-  if (!open_raw_file (checksumsink))
-    return FALSE;
+  for (i = 0; i < ranges->len; i++) {
+    GstCksumRange *range = &g_array_index (ranges, GstCksumRange, i);
 
-  return TRUE;
+    if (value >= range->start && value <= range->stop)
+      return TRUE;
+  }
+  return FALSE;
 }
 
+/* A frame is in a time range when its running time @rt is, or for a
+ * single time when it is shown at that time, up to the next frame. */
 static gboolean
-checksum_raw_file (GstCksumImageSink * checksumsink)
+time_ranges_contain (GArray * ranges, GstClockTime rt,
+    GstClockTime duration)
 {
-  GChecksum *csum;
-  FILE *fd;
-  guchar data[64 * BUFSIZ + 1];
-  size_t len;
-  gboolean ret;
+  guint i;
 
-  if (!checksumsink->file_checksum)
-    return TRUE;
-  if (!checksumsink->raw_file_name) {
-    GST_WARNING_OBJECT (checksumsink, "unspecified raw file");
-    return FALSE;
-  }
+  for (i = 0; i < ranges->len; i++) {
+    GstCksumRange *range = &g_array_index (ranges, GstCksumRange, i);
 
-  ret = FALSE;
-  fd = fopen (checksumsink->raw_file_name, "r");
-  if (!fd) {
-    GST_WARNING_OBJECT (checksumsink, "failed to open %s: %s",
-        checksumsink->raw_file_name, strerror (errno));
-    goto remove_file;
+    if (range->start == range->stop && GST_CLOCK_TIME_IS_VALID (duration)) {
+      if (rt <= range->start && range->start < rt + duration)
+        return TRUE;
+    } else if (rt >= range->start && rt <= range->stop) {
+      return TRUE;
+    }
   }
+  return FALSE;
+}
+
+static gboolean
+ranges_ended (GArray * ranges, guint64 value)
+{
+  guint i;
 
-  csum = g_checksum_new (G_CHECKSUM_MD5);
+  for (i = 0; i < ranges->len; i++) {
+    if (value <= g_array_index (ranges, GstCksumRange, i).stop)
+      return FALSE;
+  }
+  return TRUE;
+}
 
-  while ((len = fread (data, 1, 64 * BUFSIZ, fd)) > 0)
-    g_checksum_update (csum, data, len);
+static void
+seek_to_range (GstElement * element, gpointer user_data)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (element);
+  GstEvent *seek;
+
+  GST_INFO_OBJECT (checksumsink, "seeking to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (checksumsink->seek_time));
+
+  seek = gst_event_new_seek (1.0, GST_FORMAT_TIME,
+      GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, GST_SEEK_TYPE_SET,
+      checksumsink->seek_time, GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
+  if (!gst_pad_push_event (GST_BASE_SINK_PAD (checksumsink), seek)) {
+    GST_WARNING_OBJECT (checksumsink, "seek to first range failed");
+    checksumsink->seek_pending = FALSE;
+  }
+}
 
-  g_print ("%s\n", g_checksum_get_string (csum));
+#if !GST_CHECK_VERSION (1, 10, 0)
+static gpointer
+seek_thread (gpointer data)
+{
+  seek_to_range (data, NULL);
+  gst_object_unref (data);
+  return NULL;
+}
+#endif
 
-  g_checksum_free (csum);
-  fclose (fd);
+/* Asks upstream, from another thread, to skip to the earliest range */
+static void
+maybe_seek_to_range (GstCksumImageSink * checksumsink)
+{
+  GstVideoInfo *vinfo = &checksumsink->vinfo;
+  GstClockTime target = GST_CLOCK_TIME_NONE;
+  guint i;
+
+  if (!checksumsink->seek_to_range || checksumsink->seek_done)
+    return;
+  checksumsink->seek_done = TRUE;
+
+  for (i = 0; checksumsink->time_ranges
+      && i < checksumsink->time_ranges->len; i++) {
+    target = MIN (target,
+        g_array_index (checksumsink->time_ranges, GstCksumRange, i).start);
+  }
 
-  ret = TRUE;
+  for (i = 0; checksumsink->frame_ranges
+      && i < checksumsink->frame_ranges->len
+      && GST_VIDEO_INFO_FPS_N (vinfo) > 0; i++) {
+    guint64 start =
+        g_array_index (checksumsink->frame_ranges, GstCksumRange, i).start;
 
-remove_file:
-  /* don't remove if we expect to keep the raw output */
-  if (!checksumsink->dump_output && g_unlink (checksumsink->raw_file_name) != 0) {
-    GST_WARNING_OBJECT (checksumsink, "failed to remove %s: %s",
-        checksumsink->raw_file_name, strerror (errno));
+    target = MIN (target, gst_util_uint64_scale (start,
+            GST_VIDEO_INFO_FPS_D (vinfo) * GST_SECOND,
+            GST_VIDEO_INFO_FPS_N (vinfo)));
   }
 
-  return ret;
+  if (!GST_CLOCK_TIME_IS_VALID (target) || target == 0)
+    return;
+
+  checksumsink->seek_time = target;
+  checksumsink->seek_pending = TRUE;
+#if GST_CHECK_VERSION (1, 10, 0)
+  gst_element_call_async (GST_ELEMENT (checksumsink), seek_to_range, NULL,
+      NULL);
+#else
+  g_thread_unref (g_thread_new ("cksum-seek", seek_thread,
+          gst_object_ref (checksumsink)));
+#endif
 }
 
-static gboolean
-gst_cksum_image_sink_stop (GstBaseSink * sink)
+typedef enum
 {
-  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
-
-  if (checksumsink->fd != -1) {
-    fsync (checksumsink->fd);
-    close (checksumsink->fd);
+  FRAME_SELECTED,
+  FRAME_SKIPPED,
+  FRAME_AFTER_RANGES
+} FrameSelection;
+
+/* Decides, before anything is mapped, whether @buffer falls into the
+ * requested frame or time ranges. Frames are selected when they are in
+ * any of the ranges, or when no range is set. */
+static FrameSelection
+select_frame (GstCksumImageSink * checksumsink, GstBuffer * buffer)
+{
+  GArray *frame_ranges = checksumsink->frame_ranges;
+  GArray *time_ranges = checksumsink->time_ranges;
+  guint64 frame_num = checksumsink->frame_num++;
+  GstClockTime rt = GST_CLOCK_TIME_NONE;
+  GstClockTime duration = GST_CLOCK_TIME_NONE;
+
+  if (!frame_ranges && !time_ranges)
+    return FRAME_SELECTED;
+
+  if (checksumsink->seek_pending)
+    return FRAME_SKIPPED;
+  maybe_seek_to_range (checksumsink);
+  if (checksumsink->seek_pending)
+    return FRAME_SKIPPED;
+
+  if (time_ranges) {
+    rt = gst_segment_to_running_time (&GST_BASE_SINK (checksumsink)->segment,
+        GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+    if (GST_CLOCK_TIME_IS_VALID (rt))
+      rt += checksumsink->time_offset;
+
+    duration = GST_BUFFER_DURATION (buffer);
+    if (!GST_CLOCK_TIME_IS_VALID (duration)
+        && GST_VIDEO_INFO_FPS_N (&checksumsink->vinfo) > 0)
+      duration = gst_util_uint64_scale_int (GST_SECOND,
+          GST_VIDEO_INFO_FPS_D (&checksumsink->vinfo),
+          GST_VIDEO_INFO_FPS_N (&checksumsink->vinfo));
   }
 
-  checksum_raw_file (checksumsink);
+  if (frame_ranges && ranges_contain (frame_ranges, frame_num))
+    return FRAME_SELECTED;
+  if (time_ranges && GST_CLOCK_TIME_IS_VALID (rt)
+      && time_ranges_contain (time_ranges, rt, duration))
+    return FRAME_SELECTED;
 
-  g_clear_pointer (&checksumsink->raw_file_name, g_free);
+  if ((!frame_ranges || ranges_ended (frame_ranges, frame_num))
+      && (!time_ranges || (GST_CLOCK_TIME_IS_VALID (rt)
+              && ranges_ended (time_ranges, rt))))
+    return FRAME_AFTER_RANGES;
 
-  g_clear_pointer (&checksumsink->data, g_free);
-  checksumsink->data_size = 0;
+  GST_LOG_OBJECT (checksumsink, "skipping frame %" G_GUINT64_FORMAT,
+      frame_num);
+  return FRAME_SKIPPED;
+}
 
-  return TRUE;
+static void
+store_cached_digest (GstCksumImageSink * checksumsink, GstMemory * mem,
+    guint n_planes)
+{
+  GstCksumDigestCache *cache = &checksumsink->cache;
+
+  clear_digest_cache (checksumsink);
+  /* the reference only keeps the address from being reused by another
+   * memory, it doesn't lock it */
+  cache->mem = gst_memory_ref (mem);
+  cache->offset = mem->offset;
+  cache->size = mem->size;
+  cache->hashes = get_hashes (checksumsink);
+  if (needs_plane_checksum (checksumsink)) {
+    memcpy (cache->plane_csum, checksumsink->plane_csum,
+        sizeof (cache->plane_csum));
+    cache->n_planes = n_planes;
+  }
+  if (needs_frame_checksum (checksumsink))
+    memcpy (cache->frame_csum, checksumsink->frame_csum,
+        sizeof (cache->frame_csum));
+  else
+    cache->frame_csum[get_primary_hash (checksumsink)][0] = '\0';
+}
+
+/* Starts writing out each write_behind bytes of the dump as soon as
+ * they are complete, then waits for the previous range to be on disk
+ * and drops it from the page cache. This keeps the amount of dirty
+ * pages bounded, so the final flush is short, and doesn't evict the
+ * working set of other processes. */
+static void
+write_behind (GstCksumImageSink * checksumsink)
+{
+#ifdef HAVE_SYNC_FILE_RANGE
+  guint64 range = checksumsink->write_behind;
+  gint fd = checksumsink->fd;
+
+  if (range == 0)
+    return;
+
+  while (checksumsink->written - checksumsink->synced >= range) {
+    guint64 offset = checksumsink->synced;
+
+    sync_file_range (fd, offset, range, SYNC_FILE_RANGE_WRITE);
+    if (offset >= range) {
+      sync_file_range (fd, offset - range, range,
+          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+          SYNC_FILE_RANGE_WAIT_AFTER);
+#ifdef HAVE_POSIX_FADVISE
+      /* the file checksum reads the dump back */
+      if (!checksumsink->file_checksum)
+        posix_fadvise (fd, offset - range, range, POSIX_FADV_DONTNEED);
+#endif
+    }
+    checksumsink->synced += range;
+  }
+#endif
 }
 
 static gboolean
-gst_cksum_image_sink_set_caps (GstBaseSink * base_sink, GstCaps * caps)
+write_raw_data (GstCksumImageSink * checksumsink, const guint8 * data,
+    gsize size)
 {
-  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (base_sink);
-  GstVideoInfo vinfo;
+  GST_MEMDUMP ("frame", data, size);
 
-  if (!caps)
-    return FALSE;
-  if (!gst_video_info_from_caps (&vinfo, caps))
-    return FALSE;
+  while (size > 0) {
+    ssize_t written = write (checksumsink->fd, data, size);
 
-  checksumsink->vinfo = vinfo;
+    if (written == -1) {
+      if (errno == EINTR)
+        continue;
+      GST_ELEMENT_ERROR (checksumsink, RESOURCE, WRITE,
+          ("Failed to write to the file: %s", g_strerror (errno)), (NULL));
+      return FALSE;
+    }
+    data += written;
+    size -= written;
+    checksumsink->written += written;
+  }
+
+  write_behind (checksumsink);
 
   return TRUE;
 }
 
+/* chunks only apply to the packed frame of the flat mode */
 static gboolean
-gst_cksum_image_sink_propose_allocation (GstBaseSink * base_sink,
-    GstQuery * query)
+is_chunked (GstCksumImageSink * checksumsink)
 {
-  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
-  return TRUE;
+  return checksumsink->chunk_size > 0
+      && checksumsink->digest_mode == GST_CKSUM_DIGEST_MODE_FLAT;
 }
 
-static guint8 *
-alloc_data (GstCksumImageSink * checksumsink, gsize size)
+/* the staging buffer holds a whole frame, or a chunk of at least a row */
+static gsize
+get_staging_size (GstCksumImageSink * checksumsink, const GstVideoInfo * info)
 {
-  if (checksumsink->data && checksumsink->data_size == size)
-    return checksumsink->data;
+  gsize size;
+  guint plane;
 
-  if (checksumsink->data && checksumsink->data_size != size) {
-    checksumsink->data = g_realloc (checksumsink->data, size);
-    checksumsink->data_size = size;
-    return checksumsink->data;
-  }
+  if (!is_chunked (checksumsink))
+    return GST_VIDEO_INFO_SIZE (info);
 
-  if (!checksumsink->data && size > 0) {
-    checksumsink->data = g_malloc (size);
-    checksumsink->data_size = size;
-    return checksumsink->data;
+  size = checksumsink->chunk_size;
+  for (plane = 0; plane < GST_VIDEO_INFO_N_PLANES (info); plane++)
+    size = MAX (size, gst_cksum_plane_row_size (info, plane));
+  return size;
+}
+
+/* Walks @planes as many rows at a time as fit in the staging buffer and
+ * writes each chunk out, so that memory use doesn't grow with the frame
+ * size. Rows are only copied when written. Sets @size to the packed size
+ * of the frame. */
+static gboolean
+walk_chunked (GstCksumImageSink * checksumsink, const GstCksumPlanes * planes,
+    const GstCksumWalker * walker, gsize * size)
+{
+  gboolean write = checksumsink->file_checksum || checksumsink->dump_output;
+  guint8 *dest = write ? checksumsink->data : NULL;
+  GstCksumPlanes slice;
+  guint plane, row, rows, n_rows;
+  gsize chunk;
+
+  *size = 0;
+  for (plane = 0; plane < planes->n_planes; plane++) {
+    if (planes->row_size[plane] == 0)
+      continue;
+
+    rows = MAX (1, checksumsink->data_size / planes->row_size[plane]);
+    for (row = 0; row < planes->height[plane]; row += n_rows) {
+      n_rows = MIN (rows, planes->height[plane] - row);
+      gst_cksum_planes_slice (planes, plane, row, n_rows, &slice);
+      chunk = gst_cksum_walk_planes (&slice, dest, walker);
+      if (write && !write_raw_data (checksumsink, dest, chunk))
+        return FALSE;
+      *size += chunk;
+    }
   }
 
-  return NULL;
+  return TRUE;
+}
+
+/* anything in need of the pixels of the frame */
+static gboolean
+needs_pixels (GstCksumImageSink * checksumsink)
+{
+  return needs_frame_checksum (checksumsink)
+      || needs_plane_checksum (checksumsink) || checksumsink->log_leaves
+      || checksumsink->file_checksum || checksumsink->dump_output
+      || checksumsink->sei_pad != NULL;
 }
 
 static GstFlowReturn
-gst_cksum_image_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+hash_frame (GstCksumImageSink * checksumsink, GstBuffer * buffer,
+    GstMemory * mem)
 {
-  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
-  gchar *csum;
+  GstFlowReturn ret = GST_FLOW_OK;
   GstVideoFrame frame;
   GstVideoInfo *vinfo;
   guint8 *data;
   gsize size;
-
-  if (checksumsink->eos_after == 0) {
-    GST_DEBUG_OBJECT (checksumsink, "Force EOS as requested");
-    return GST_FLOW_EOS;
-  } else if (checksumsink->eos_after > 0) {
-    checksumsink->eos_after--;
-  }
+  guint n_planes;
+  gboolean gated, strong, print, chunked, whole = TRUE;
+  GstCksumHasher **dph = NULL;
+  GstCksumDphType dph_type = GST_CKSUM_DPH_MD5;
+  guint n_dph = 0, i;
 
   vinfo = &checksumsink->vinfo;
   if (!gst_video_frame_map (&frame, vinfo, buffer, GST_MAP_READ)) {
@@ -421,87 +3517,505 @@ gst_cksum_image_sink_render (GstBaseSink * sink, GstBuffer * buffer)
     return GST_FLOW_ERROR;
   }
 
-  if (!(data = alloc_data (checksumsink, GST_VIDEO_FRAME_SIZE (&frame)))) {
+  chunked = is_chunked (checksumsink);
+  if (!(data = alloc_data (checksumsink,
+              get_staging_size (checksumsink, &frame.info)))) {
     GST_ERROR_OBJECT (checksumsink, "failed to allocate buffer");
-    return GST_FLOW_ERROR;
+    ret = GST_FLOW_ERROR;
+    goto done;
   }
 
-  {
-    guint j, n_planes, plane;
-    guint8 *dp;
+  n_planes = GST_VIDEO_FRAME_N_PLANES (&frame);
+
+  /* when gated, the strong digests are printed only for the periodic
+   * frames, and hashed from the staging buffer on mismatch. The stream
+   * checksum still chains the strong digests of every frame, and the
+   * reference compares them. */
+  gated = is_gated (checksumsink);
+  print = !gated || (checksumsink->strong_interval > 0
+      && checksumsink->gate_frames % checksumsink->strong_interval == 0);
+  strong = print || checksumsink->stream_checksum
+      || checksumsink->reference != NULL;
+
+  if (checksumsink->digest_mode != GST_CKSUM_DIGEST_MODE_FLAT) {
+    size = hash_tiles (checksumsink, &frame, data);
+  } else {
+    GstCksumHasher *gate_ctx = NULL;
+    GstCksumHashType types[GST_CKSUM_N_HASHES];
+    GstCksumWalker walker;
+    GstCksumPlanes planes;
+    guint n_types = 0;
+
+    n_planes = init_planes (checksumsink, &planes, &frame);
+    whole = n_planes == GST_VIDEO_FRAME_N_PLANES (&frame)
+        && !gst_buffer_get_video_crop_meta (buffer);
+
+    if (strong)
+      n_types = setup_walker (checksumsink, &walker, types, n_planes);
+    else
+      memset (&walker, 0, sizeof (GstCksumWalker));
+    if (gated) {
+      gate_ctx = get_gate_context (checksumsink);
+      walker.frame[walker.n_hashers++] = gate_ctx;
+    }
+    /* the picture hashes cover the whole decoded picture, in the same
+     * pass when nothing is cropped or masked */
+    dph = get_picture_hashers (checksumsink, &frame, &dph_type, &n_dph);
+    if (dph && whole) {
+      for (i = 0; i < n_dph; i++)
+        walker.plane[i][walker.n_hashers] = dph[i];
+      walker.n_hashers++;
+    }
 
-    dp = data;
-    size = 0;
-    n_planes = GST_VIDEO_FRAME_N_PLANES (&frame);
+    GST_CAT_DEBUG_OBJECT (CAT_PERFORMANCE, checksumsink,
+        "copy %u planes, %u hashers", n_planes, walker.n_hashers);
+    if (!chunked) {
+      size = gst_cksum_walk_planes (&planes, data, &walker);
+      gst_cksum_planes_pack (&planes, &checksumsink->staged, data);
+    } else {
+      if (!walk_chunked (checksumsink, &planes, &walker, &size))
+        ret = GST_FLOW_ERROR;
+      /* the frame itself, as long as it is mapped */
+      checksumsink->staged = planes;
+    }
+    finish_walker (checksumsink, &walker, types, n_types, n_planes);
 
-    for (plane = 0; plane < n_planes; plane++) {
-      gpointer pd = GST_VIDEO_FRAME_PLANE_DATA (&frame, plane);
-
-      /* FIXME: assumes subsampling of component N is the same as
-       * plane N, which is currently true for all formats we have but
-       * it might not be in the future. */
-      gint w = GST_VIDEO_FRAME_COMP_WIDTH (&frame, plane)
-          * GST_VIDEO_FRAME_COMP_PSTRIDE (&frame, plane);
-      /* FIXME: workaround for complex formats like v210, UYVP and
-       * IYU1 that have pstride == 0 */
-      if (w == 0)
-        w = GST_VIDEO_FRAME_PLANE_STRIDE (&frame, plane);
-      gint h = GST_VIDEO_FRAME_COMP_HEIGHT (&frame, plane);
-      gint ps = GST_VIDEO_FRAME_PLANE_STRIDE (&frame, plane);
-
-      /* current plane size and data required for plane_checksum */
-      guint8 *cdp = dp;
-      gsize psz = 0;
-
-      GST_CAT_DEBUG_OBJECT (CAT_PERFORMANCE, checksumsink,
-          "copy plane %d, w:%d h:%d ", plane, w, h);
-      for (j = 0; j < h; j++) {
-        memcpy (dp, pd, w);
-        dp += w;
-        pd += ps;
-        size += w;
-        psz += w;
-      }
+    if (dph) {
+      if (!whole)
+        walk_picture (&frame, dph, n_dph);
+      finish_picture_hashers (checksumsink, &frame, dph, dph_type, n_dph);
+    }
 
-      if (checksumsink->plane_checksum) {
-        csum = g_compute_checksum_for_data (checksumsink->hash, cdp, psz);
-        g_print ("%s  ", csum);
-        g_free (csum);
+    if (gate_ctx) {
+      finish_context (gate_ctx, checksumsink->gate_csum);
+      if (checksumsink->frame_checksum)
+        log_printf ("GateChecksum %s\n", checksumsink->gate_csum);
+      if (!check_gate (checksumsink)) {
+        if (!strong)
+          hash_staged_frame (checksumsink);
+        strong = print = TRUE;
       }
     }
+  }
 
-    if (checksumsink->plane_checksum)
-      g_print ("\n");
-
-    if (checksumsink->frame_checksum) {
-      csum = g_compute_checksum_for_data (checksumsink->hash, data, size);
-      g_print ("FrameChecksum %s\n", csum);
-      g_free (csum);
+  if (print)
+    print_frame_checksums (checksumsink, get_hashes (checksumsink),
+        checksumsink->plane_csum, checksumsink->frame_csum, n_planes);
+  else
+    report_frame_checksums (checksumsink, checksumsink->plane_csum,
+        checksumsink->frame_csum, n_planes);
+  checksumsink->staged_pending = !print;
+  if (chunked)
+    gst_buffer_replace (&checksumsink->staged_buffer, print ? NULL : buffer);
+
+  update_stream_checksum (checksumsink,
+      checksumsink->frame_csum[get_primary_hash (checksumsink)]);
+
+  if (mem)
+    store_cached_digest (checksumsink, mem, n_planes);
+  checksumsink->frame_size = size;
+
+  if (!chunked && (checksumsink->file_checksum || checksumsink->dump_output)) {
+    if (whole && size != GST_VIDEO_FRAME_SIZE (&frame)) {
+      GST_WARNING ("size are different! %lu != %lu", size,
+          GST_VIDEO_FRAME_SIZE (&frame));
     }
+    if (!write_raw_data (checksumsink, data, size))
+      ret = GST_FLOW_ERROR;
   }
 
-  if (checksumsink->file_checksum || checksumsink->dump_output) {
-    GST_MEMDUMP ("frame", data, size);
-    do {
-      if (size != GST_VIDEO_FRAME_SIZE (&frame)) {
-        GST_WARNING ("size are different! %lu != %lu", size,
-            GST_VIDEO_FRAME_SIZE (&frame));
-      }
-      ssize_t written = write (checksumsink->fd, data, size);
-      if (written == -1) {
-        GST_ELEMENT_ERROR (checksumsink, RESOURCE, WRITE,
-            ("Failed to write to the file: %s", g_strerror (errno)), (NULL));
-        return GST_FLOW_ERROR;
-      } else if (written < size) {
-        data = &data[written + 1];
-        size = size - written;
-      } else if (written == size) {
+done:
+  gst_video_frame_unmap (&frame);
+
+  return ret;
+}
+
+static GstFlowReturn
+process_frame (GstCksumImageSink * checksumsink, GstBuffer * buffer)
+{
+  GstMemory *mem;
+
+  checksumsink->frame_pts = GST_BUFFER_PTS (buffer);
+  checksumsink->frame_offset = GST_BUFFER_OFFSET (buffer);
+
+  mem = get_cacheable_memory (checksumsink, buffer);
+  if (print_cached_digest (checksumsink, mem))
+    return GST_FLOW_OK;
+
+  return hash_frame (checksumsink, buffer, mem);
+}
+
+typedef enum
+{
+  WORK_FRAME,
+  WORK_SKIP,
+  WORK_DRAIN,
+  WORK_STOP
+} WorkType;
+
+typedef struct
+{
+  WorkType type;
+  GstBuffer *buffer;
+  guint64 frame_num;
+  GstClockTime running_time;
+} WorkItem;
+
+static GstClockTime
+get_running_time (GstCksumImageSink * checksumsink, GstBuffer * buffer)
+{
+  return gst_segment_to_running_time (&GST_BASE_SINK (checksumsink)->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+}
+
+static void
+push_work (GstCksumImageSink * checksumsink, WorkType type,
+    GstBuffer * buffer, guint64 frame_num)
+{
+  WorkItem *item = g_slice_new0 (WorkItem);
+
+  item->type = type;
+  item->buffer = buffer ? gst_buffer_ref (buffer) : NULL;
+  item->frame_num = frame_num;
+  item->running_time = buffer ? get_running_time (checksumsink, buffer) :
+      GST_CLOCK_TIME_NONE;
+  g_async_queue_push (checksumsink->worker_queue, item);
+}
+
+/* Must be called with worker_lock held. Keeps running averages over
+ * roughly the last 8 frames. */
+static void
+update_processing_stats (GstCksumImageSink * checksumsink,
+    GstClockTime elapsed)
+{
+  GstClockTimeDiff diff;
+
+  if (checksumsink->proc_time == 0) {
+    checksumsink->proc_time = elapsed;
+    return;
+  }
+
+  checksumsink->proc_time = (checksumsink->proc_time * 7 + elapsed) / 8;
+  diff = ABS ((GstClockTimeDiff) (elapsed - checksumsink->proc_time));
+  checksumsink->proc_jitter = (checksumsink->proc_jitter * 7 + diff) / 8;
+}
+
+/* In live-monitor mode, accounts the processing time in the latency
+ * through the processing deadline, following the average up and down. */
+static void
+update_processing_deadline (GstCksumImageSink * checksumsink)
+{
+  GstClockTime deadline, current;
+
+  if (!checksumsink->monitoring || !GST_CHECK_VERSION (1, 16, 0))
+    return;
+
+  g_mutex_lock (&checksumsink->worker_lock);
+  deadline = checksumsink->proc_time + 2 * checksumsink->proc_jitter;
+  g_mutex_unlock (&checksumsink->worker_lock);
+
+  /* only react to significant changes, a latency update is expensive */
+  current = get_processing_deadline (checksumsink);
+  if (deadline <= current * 5 / 4 && deadline >= current * 3 / 4)
+    return;
+
+  GST_DEBUG_OBJECT (checksumsink, "processing deadline now %"
+      GST_TIME_FORMAT, GST_TIME_ARGS (deadline));
+  set_processing_deadline (checksumsink, deadline);
+  gst_element_post_message (GST_ELEMENT (checksumsink),
+      gst_message_new_latency (GST_OBJECT (checksumsink)));
+}
+
+/* In async mode render() returns before frames are processed, hiding the
+ * processing time from the QoS of the base class, so tell upstream
+ * ourselves when a frame was processed too late. */
+static void
+send_qos (GstCksumImageSink * checksumsink, GstClockTime running_time)
+{
+  GstElement *element = GST_ELEMENT (checksumsink);
+  GstVideoInfo *vinfo = &checksumsink->vinfo;
+  GstClock *clock;
+  GstClockTime now, deadline, duration;
+  GstClockTimeDiff jitter;
+  gdouble proportion = 1.0;
+
+  if (!checksumsink->monitoring || !GST_CLOCK_TIME_IS_VALID (running_time))
+    return;
+  if (!(clock = gst_element_get_clock (element)))
+    return;
+
+  now = gst_clock_get_time (clock) - gst_element_get_base_time (element);
+  gst_object_unref (clock);
+
+  deadline = running_time + gst_base_sink_get_latency (GST_BASE_SINK (element))
+      + get_processing_deadline (checksumsink);
+  jitter = GST_CLOCK_DIFF (deadline, now);
+  if (jitter <= 0)
+    return;
+
+  if (GST_VIDEO_INFO_FPS_N (vinfo) > 0) {
+    duration = gst_util_uint64_scale_int (GST_SECOND,
+        GST_VIDEO_INFO_FPS_D (vinfo), GST_VIDEO_INFO_FPS_N (vinfo));
+    g_mutex_lock (&checksumsink->worker_lock);
+    proportion = checksumsink->proc_time / (gdouble) duration;
+    g_mutex_unlock (&checksumsink->worker_lock);
+  }
+
+  GST_CAT_DEBUG_OBJECT (CAT_PERFORMANCE, checksumsink, "frame processed %"
+      GST_STIME_FORMAT " late", GST_STIME_ARGS (jitter));
+  gst_pad_push_event (GST_BASE_SINK_PAD (element),
+      gst_event_new_qos (GST_QOS_TYPE_UNDERFLOW, proportion, jitter,
+          running_time));
+}
+
+static gpointer
+worker_func (gpointer user_data)
+{
+  GstCksumImageSink *checksumsink = user_data;
+  gboolean running = TRUE;
+
+  while (running) {
+    WorkItem *item = g_async_queue_pop (checksumsink->worker_queue);
+    GstFlowReturn ret;
+    gint64 start;
+
+    switch (item->type) {
+      case WORK_FRAME:
+        start = g_get_monotonic_time ();
+        ret = process_frame (checksumsink, item->buffer);
+        gst_buffer_unref (item->buffer);
+
+        g_mutex_lock (&checksumsink->worker_lock);
+        update_processing_stats (checksumsink,
+            (g_get_monotonic_time () - start) * GST_USECOND);
+        if (ret != GST_FLOW_OK)
+          checksumsink->worker_ret = ret;
+        checksumsink->worker_pending--;
+        g_cond_broadcast (&checksumsink->worker_cond);
+        g_mutex_unlock (&checksumsink->worker_lock);
+
+        update_processing_deadline (checksumsink);
+        send_qos (checksumsink, item->running_time);
         break;
-      }
-    } while (TRUE);
+      case WORK_SKIP:
+        log_printf ("FrameSkipped %" G_GUINT64_FORMAT "\n", item->frame_num);
+        skip_reference (checksumsink);
+        break;
+      case WORK_DRAIN:
+        g_mutex_lock (&checksumsink->worker_lock);
+        checksumsink->worker_drain_done++;
+        g_cond_broadcast (&checksumsink->worker_cond);
+        g_mutex_unlock (&checksumsink->worker_lock);
+        break;
+      case WORK_STOP:
+        running = FALSE;
+        break;
+    }
+
+    g_slice_free (WorkItem, item);
   }
 
-  gst_video_frame_unmap (&frame);
+  return NULL;
+}
 
-  return GST_FLOW_OK;
+static gboolean
+start_worker (GstCksumImageSink * checksumsink)
+{
+  GError *err = NULL;
+
+  checksumsink->worker_queue = g_async_queue_new ();
+  checksumsink->worker_pending = 0;
+  checksumsink->worker_drain_requested = 0;
+  checksumsink->worker_drain_done = 0;
+  checksumsink->worker_flushing = FALSE;
+  checksumsink->worker_ret = GST_FLOW_OK;
+
+  checksumsink->worker = g_thread_try_new ("cksum-worker", worker_func,
+      checksumsink, &err);
+  if (!checksumsink->worker) {
+    GST_ELEMENT_ERROR (checksumsink, RESOURCE, FAILED,
+        ("failed to create hashing thread"), ("reason: %s", err->message));
+    g_error_free (err);
+    g_clear_pointer (&checksumsink->worker_queue, g_async_queue_unref);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+stop_worker (GstCksumImageSink * checksumsink)
+{
+  if (!checksumsink->worker)
+    return;
+
+  push_work (checksumsink, WORK_STOP, NULL, 0);
+  g_thread_join (checksumsink->worker);
+  checksumsink->worker = NULL;
+  g_clear_pointer (&checksumsink->worker_queue, g_async_queue_unref);
+}
+
+/* waits until the worker is done with everything queued so far */
+static void
+drain_worker (GstCksumImageSink * checksumsink)
+{
+  guint64 ticket;
+
+  if (!checksumsink->worker)
+    return;
+
+  g_mutex_lock (&checksumsink->worker_lock);
+  ticket = ++checksumsink->worker_drain_requested;
+  push_work (checksumsink, WORK_DRAIN, NULL, 0);
+  while (checksumsink->worker_drain_done < ticket)
+    g_cond_wait (&checksumsink->worker_cond, &checksumsink->worker_lock);
+  g_mutex_unlock (&checksumsink->worker_lock);
+}
+
+/* Queues @buffer to the hashing thread. With a latency budget, the frame
+ * is skipped instead when the estimated backlog exceeds it; otherwise
+ * this blocks while too many frames are queued. */
+static GstFlowReturn
+queue_frame (GstCksumImageSink * checksumsink, GstBuffer * buffer)
+{
+  guint64 budget = checksumsink->latency_budget;
+  GstFlowReturn ret;
+
+  g_mutex_lock (&checksumsink->worker_lock);
+
+  if (budget > 0) {
+    GstClockTime backlog =
+        checksumsink->worker_pending * checksumsink->proc_time;
+
+    if (backlog > budget || checksumsink->worker_pending >= MAX_PENDING_FRAMES) {
+      GST_DEBUG_OBJECT (checksumsink, "backlog %" GST_TIME_FORMAT
+          " over budget, skipping frame", GST_TIME_ARGS (backlog));
+      checksumsink->n_skipped++;
+      push_work (checksumsink, WORK_SKIP, NULL, checksumsink->frame_num - 1);
+      g_mutex_unlock (&checksumsink->worker_lock);
+      return GST_FLOW_OK;
+    }
+  }
+
+  while (checksumsink->worker_pending >= MAX_PENDING_FRAMES
+      && !checksumsink->worker_flushing)
+    g_cond_wait (&checksumsink->worker_cond, &checksumsink->worker_lock);
+
+  ret = checksumsink->worker_ret;
+  if (checksumsink->worker_flushing) {
+    ret = GST_FLOW_FLUSHING;
+  } else if (ret == GST_FLOW_OK) {
+    checksumsink->worker_pending++;
+    push_work (checksumsink, WORK_FRAME, buffer, 0);
+  }
+
+  g_mutex_unlock (&checksumsink->worker_lock);
+
+  return ret;
+}
+
+/* Drops the frames still queued to the hashing thread, the one it is
+ * hashing excepted, keeping the other items in order. Must be called
+ * with worker_lock held. */
+static void
+drop_queued_frames (GstCksumImageSink * checksumsink)
+{
+  GAsyncQueue *queue = checksumsink->worker_queue;
+  GQueue kept = G_QUEUE_INIT;
+  WorkItem *item;
+  guint dropped = 0;
+
+  if (!queue)
+    return;
+
+  g_async_queue_lock (queue);
+  while ((item = g_async_queue_try_pop_unlocked (queue))) {
+    if (item->type == WORK_FRAME) {
+      gst_buffer_unref (item->buffer);
+      g_slice_free (WorkItem, item);
+      checksumsink->worker_pending--;
+      dropped++;
+    } else {
+      g_queue_push_tail (&kept, item);
+    }
+  }
+  while ((item = g_queue_pop_head (&kept)))
+    g_async_queue_push_unlocked (queue, item);
+  g_async_queue_unlock (queue);
+
+  GST_DEBUG_OBJECT (checksumsink, "dropped %u queued frames", dropped);
+}
+
+static gboolean
+gst_cksum_image_sink_unlock (GstBaseSink * sink)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
+
+  g_mutex_lock (&checksumsink->worker_lock);
+  checksumsink->worker_flushing = TRUE;
+  drop_queued_frames (checksumsink);
+  g_cond_broadcast (&checksumsink->worker_cond);
+  g_mutex_unlock (&checksumsink->worker_lock);
+
+  return TRUE;
+}
+
+static gboolean
+gst_cksum_image_sink_unlock_stop (GstBaseSink * sink)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
+
+  /* an error of a flushed frame doesn't stop the next ones */
+  g_mutex_lock (&checksumsink->worker_lock);
+  checksumsink->worker_flushing = FALSE;
+  checksumsink->worker_ret = GST_FLOW_OK;
+  g_mutex_unlock (&checksumsink->worker_lock);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_cksum_image_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  GstCksumImageSink *checksumsink = GST_CKSUM_IMAGE_SINK (sink);
+  GstFlowReturn ret;
+  gint64 start;
+
+  update_throughput (checksumsink, buffer);
+
+  if (checksumsink->eos_after == 0) {
+    GST_DEBUG_OBJECT (checksumsink, "Force EOS as requested");
+    return GST_FLOW_EOS;
+  } else if (checksumsink->eos_after > 0) {
+    checksumsink->eos_after--;
+  }
+
+  switch (select_frame (checksumsink, buffer)) {
+    case FRAME_SKIPPED:
+      return GST_FLOW_OK;
+    case FRAME_AFTER_RANGES:
+      GST_DEBUG_OBJECT (checksumsink, "EOS after the last range");
+      return GST_FLOW_EOS;
+    default:
+      break;
+  }
+
+  /* mapping can be expensive, e.g. for hardware memory, so don't map
+   * frames nobody is going to look at */
+  if (!needs_pixels (checksumsink))
+    return GST_FLOW_OK;
+
+  if (checksumsink->worker)
+    return queue_frame (checksumsink, buffer);
+
+  start = g_get_monotonic_time ();
+  ret = process_frame (checksumsink, buffer);
+
+  g_mutex_lock (&checksumsink->worker_lock);
+  update_processing_stats (checksumsink,
+      (g_get_monotonic_time () - start) * GST_USECOND);
+  g_mutex_unlock (&checksumsink->worker_lock);
+  update_processing_deadline (checksumsink);
+
+  return ret;
 }
@@ -25,6 +25,10 @@
 #include <gst/video/gstvideosink.h>
 #include <gst/video/video.h>
 
+#include "gstcksumdph.h"
+#include "gstcksumframe.h"
+#include "gstcksumref.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_CKSUM_IMAGE_SINK   (gst_cksum_image_sink_get_type())
@@ -35,6 +39,99 @@ G_BEGIN_DECLS
 
 typedef struct _GstCksumImageSink GstCksumImageSink;
 typedef struct _GstCksumImageSinkClass GstCksumImageSinkClass;
+typedef struct _GstCksumDigestCache GstCksumDigestCache;
+typedef struct _GstCksumTile GstCksumTile;
+typedef struct _GstCksumRange GstCksumRange;
+typedef struct _GstCksumThroughput GstCksumThroughput;
+
+typedef enum
+{
+  GST_CKSUM_DIGEST_MODE_FLAT,
+  GST_CKSUM_DIGEST_MODE_TILES,
+  GST_CKSUM_DIGEST_MODE_STRIPES
+} GstCksumDigestMode;
+
+typedef enum
+{
+  GST_CKSUM_SYNC_MODE_SYNC,
+  GST_CKSUM_SYNC_MODE_ASYNC,
+  GST_CKSUM_SYNC_MODE_NONE
+} GstCksumSyncMode;
+
+typedef enum
+{
+  GST_CKSUM_HUGE_PAGES_NONE,
+  GST_CKSUM_HUGE_PAGES_TRANSPARENT,
+  GST_CKSUM_HUGE_PAGES_EXPLICIT
+} GstCksumHugePages;
+
+typedef enum
+{
+  GST_CKSUM_REF_KEY_POSITION,
+  GST_CKSUM_REF_KEY_PTS,
+  GST_CKSUM_REF_KEY_OFFSET
+} GstCksumRefKey;
+
+/* digests of the last frame, keyed on the identity of the memory it
+ * was read from, so a re-pushed memory is not hashed again */
+struct _GstCksumDigestCache
+{
+  GstMemory *mem;
+  gsize offset;
+  gsize size;
+
+  guint hashes;
+  gchar plane_csum[GST_CKSUM_N_HASHES][GST_VIDEO_MAX_PLANES]
+      [GST_CKSUM_MAX_HEX_SIZE];
+  guint n_planes;
+  gchar frame_csum[GST_CKSUM_N_HASHES][GST_CKSUM_MAX_HEX_SIZE];
+};
+
+/* inclusive range of frame numbers or running times, stop being
+ * G_MAXUINT64 for open ranges */
+struct _GstCksumRange
+{
+  guint64 start;
+  guint64 stop;
+};
+
+/* buffer arrival statistics, times in microseconds; the inter-arrival
+ * mean and sum of squared deviations are updated with Welford's method */
+struct _GstCksumThroughput
+{
+  gint64 start;
+  gint64 last;
+  guint64 frames;
+  guint64 bytes;
+  gdouble mean;
+  gdouble m2;
+
+  /* the same since report_time, for the periodic lines */
+  gint64 report_time;
+  guint64 report_frames;
+  guint64 report_bytes;
+  guint64 report_deltas;
+  gdouble report_mean;
+  gdouble report_m2;
+};
+
+/* a rectangle of one plane of the staging buffer, in bytes, with the
+ * digest of its rows: a leaf of the frame digest in tiles and stripes
+ * digest modes */
+struct _GstCksumTile
+{
+  guint plane;
+  gint x;
+  gint y;
+  gint width;
+  gint height;
+  gsize offset;
+  gsize stride;
+
+  GstCksumHasher *csum;
+  gboolean dirty;
+  guint8 digest[GST_CKSUM_MAX_DIGEST_SIZE];
+};
 
 struct _GstCksumImageSink
 {
@@ -42,18 +139,189 @@ struct _GstCksumImageSink
   GstVideoInfo vinfo;
 
   /* properties */
-  GChecksumType hash;
+  GstCksumHashType hash;
+  guint hashes;
   gboolean file_checksum;
+  GstCksumHashType file_hash;
   gboolean frame_checksum;
   gboolean plane_checksum;
   gboolean dump_output;
+  GstCksumSyncMode sync_mode;
+  guint64 write_behind;
+  GstCksumHugePages huge_pages;
+  guint chunk_size;
+  guint plane_mask;
   gint eos_after;
+  gchar *frame_ranges_str;
+  gchar *time_ranges_str;
+  gboolean seek_to_range;
+  gboolean measure_throughput;
+  gboolean touch_pages;
+  guint report_interval;
+  gboolean async_hashing;
+  guint64 latency_budget;
+  gboolean live_monitor;
+  gboolean cache_digests;
+  GstCksumDigestMode digest_mode;
+  guint tile_size;
+  guint stripe_height;
+  guint n_threads;
+  gboolean log_leaves;
+  gboolean stream_checksum;
+  guint stream_checksum_interval;
+  gchar *gate_hash;
+  const GstCksumEngine *gate_engine;
+  gchar *gate_reference;
+  guint strong_interval;
+  GstCksumRefFormat output_format;
+  gchar *reference_location;
+  GstCksumRefFormat reference_format;
+  GstCksumRefKey reference_key;
+  guint align_window;
 
   gchar *raw_file_name;
   gint fd;
+  /* bytes written to the dump and handed to write-behind */
+  guint64 written;
+  guint64 synced;
 
   guint8 *data;
   gsize data_size;
+  /* length of the mapping when data is backed by huge pages, else 0 */
+  gsize data_mapped;
+
+  /* frame selection: frame_num counts the buffers received, time_offset
+   * is added to running times after seeking to the first range */
+  GArray *frame_ranges;
+  GArray *time_ranges;
+  guint64 frame_num;
+  GstClockTime time_offset;
+  GstClockTime seek_time;
+  gboolean seek_done;
+  gboolean seek_pending;
+
+  GstCksumThroughput throughput;
+
+  /* hashing thread in async mode, worker_pending counting the frames
+   * queued to it */
+  GThread *worker;
+  GAsyncQueue *worker_queue;
+  GMutex worker_lock;
+  GCond worker_cond;
+  guint worker_pending;
+  guint64 worker_drain_requested;
+  guint64 worker_drain_done;
+  gboolean worker_flushing;
+  GstFlowReturn worker_ret;
+  guint64 n_skipped;
+
+  /* running average and jitter of the processing time per frame,
+   * protected by worker_lock */
+  GstClockTime proc_time;
+  GstClockTime proc_jitter;
+
+  /* live-monitor as applied at start, with the sync and QoS settings it
+   * overrode until stop */
+  gboolean monitoring;
+  gboolean saved_sync;
+  gboolean saved_qos;
+
+  GstCksumDigestCache cache;
+
+  /* hash contexts reset for every frame and digests of the current
+   * frame, so that no allocation happens once the first frame is done;
+   * one of each per hash type */
+  GstCksumHasher *plane_ctx[GST_CKSUM_N_HASHES][GST_VIDEO_MAX_PLANES];
+  GstCksumHasher *frame_ctx[GST_CKSUM_N_HASHES];
+  gchar plane_csum[GST_CKSUM_N_HASHES][GST_VIDEO_MAX_PLANES]
+      [GST_CKSUM_MAX_HEX_SIZE];
+  gchar frame_csum[GST_CKSUM_N_HASHES][GST_CKSUM_MAX_HEX_SIZE];
+  gchar hash_name[16];
+
+  /* digest chaining the frame checksums of the whole stream, valid once
+   * stream_frames > 0 */
+  GstCksumHasher *stream_ctx;
+  gchar stream_csum[GST_CKSUM_MAX_HEX_SIZE];
+  guint64 stream_frames;
+  guint64 stream_printed;
+
+  /* cheap digest computed for every frame when a gate hash is set, the
+   * strong digests being computed only when needed; gate_refs holds the
+   * expected gate digests, in frame order */
+  GstCksumHasher *gate_ctx;
+  gchar gate_csum[GST_CKSUM_MAX_HEX_SIZE];
+  GPtrArray *gate_refs;
+  guint64 gate_frames;
+  guint64 gate_mismatches;
+
+  /* layout of the frame left in the staging buffer, whose strong digests
+   * are still to be computed when staged_pending is set */
+  GstCksumPlanes staged;
+  gboolean staged_pending;
+  /* the frame itself in chunked mode, where the staging buffer only holds
+   * its last chunk */
+  GstBuffer *staged_buffer;
+
+  /* frames whose checksums were reported, printed or not when gated,
+   * compared with the reference in that order or by key, ref_seen
+   * marking the entries found by key; pts, offset, size and cropped
+   * dimensions are the ones of the last frame */
+  guint64 reported_frames;
+  gboolean header_printed;
+  GstClockTime frame_pts;
+  guint64 frame_offset;
+  gsize frame_size;
+  guint frame_width;
+  guint frame_height;
+  GstCksumRef *reference;
+  guint8 *ref_seen;
+  guint64 ref_matched;
+  guint64 ref_mismatches;
+  guint64 ref_extra;
+  /* until the stream is aligned with the reference, the digests of its
+   * first frames; frame n is then compared with reference frame n +
+   * ref_offset. The digests of the current run of mismatches, from frame
+   * realign_start, are looked up again once it is align_window long. */
+  GPtrArray *align_pending;
+  GPtrArray *realign_digests;
+  guint64 realign_start;
+  gint64 ref_offset;
+
+  /* decoded picture hashes of the access units of the sei pad and of the
+   * frames, keyed on their PTS, until the other side of each arrives;
+   * matched entries go to dph_free for reuse, and the SEI payloads are
+   * unescaped into sei_rbsp */
+  GstPad *sei_pad;
+  gboolean sei_vvc;
+  GMutex sei_lock;
+  GHashTable *sei_expected;
+  GHashTable *sei_computed;
+  GPtrArray *dph_free;
+  GByteArray *sei_rbsp;
+  GstCksumDphType dph_type;
+  GstCksumHasher *dph_ctx[GST_CKSUM_DPH_N_TYPES]
+      [GST_CKSUM_DPH_MAX_COMPONENTS];
+  guint64 dph_mismatches;
+  guint64 dph_unverified;
+  guint64 dph_no_pts;
+
+  /* tile layout of the staging buffer, which holds the previous frame
+   * when tiles_valid is set, and the nodes of the hash tree of their
+   * digests */
+  GstCksumTile *tiles;
+  guint8 *tree_nodes;
+  guint n_tiles;
+  gsize tiles_size;
+  gboolean tiles_valid;
+
+  /* hashes tiles in parallel, pool_frame and pool_data being the
+   * frame being hashed and its staging buffer */
+  GThreadPool *pool;
+  GMutex pool_lock;
+  GCond pool_cond;
+  guint pool_pending;
+  GstVideoFrame *pool_frame;
+  guint8 *pool_data;
 };
 
 struct _GstCksumImageSinkClass
@@ -0,0 +1,484 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* gst-cksum: prints the checksums of the frames of a raw video or Y4M
+ * file as checksumsink does, hashing frames in parallel.
+ *
+ *   gst-cksum -f I420 -s 1920x1080 dump.yuv
+ *   gst-cksum --hash md5,sha256 --plane-checksum clip.y4m
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gst/gst.h>
+
+#include "gstcksumframe.h"
+
+/* frames hashed before their checksums are printed */
+#define BATCH_FRAMES 256
+
+#define Y4M_MAGIC "YUV4MPEG2 "
+#define Y4M_FRAME "FRAME"
+
+typedef struct
+{
+  GstVideoInfo info;
+  guint hashes;
+  gboolean plane_checksum;
+  gboolean frame_checksum;
+
+  const guint8 *data;
+  gsize size;
+
+  /* offsets of the frames in data */
+  GArray *offsets;
+  gsize frame_size;
+
+  /* checksum lines of the frames of the current batch */
+  gchar (*text)[GST_CKSUM_FRAME_TEXT_SIZE];
+  guint batch_start;
+  guint batch_len;
+
+  GMutex lock;
+  GCond cond;
+  guint pending;
+} CksumJob;
+
+typedef struct
+{
+  CksumJob *job;
+  guint first;
+  guint last;
+} CksumTask;
+
+static gchar *opt_format;
+static gchar *opt_size;
+static gchar *opt_hash = (gchar *) "md5";
+static gboolean opt_plane_checksum;
+static gboolean opt_frame_checksum = TRUE;
+static gint opt_threads;
+
+static GOptionEntry entries[] = {
+  {"format", 'f', 0, G_OPTION_ARG_STRING, &opt_format,
+      "video format of raw files (e.g. I420, NV12)", "FORMAT"},
+  {"size", 's', 0, G_OPTION_ARG_STRING, &opt_size,
+      "frame size of raw files", "WIDTHxHEIGHT"},
+  {"hash", 'a', 0, G_OPTION_ARG_STRING, &opt_hash,
+      "comma separated checksum types (default md5)", "HASHES"},
+  {"plane-checksum", 'p', 0, G_OPTION_ARG_NONE, &opt_plane_checksum,
+      "print the checksum of every plane", NULL},
+  {"no-frame-checksum", 'n', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE,
+      &opt_frame_checksum, "don't print the frame checksums", NULL},
+  {"threads", 'j', 0, G_OPTION_ARG_INT, &opt_threads,
+      "number of hashing threads (0 = one per CPU)", "N"},
+  {NULL}
+};
+
+static gboolean
+parse_hashes (const gchar * str, guint * hashes)
+{
+  gchar **names, **n;
+  gboolean ret = TRUE;
+
+  *hashes = 0;
+  names = g_strsplit (str, ",", -1);
+  for (n = names; *n; n++) {
+    const GstCksumEngine *engine = gst_cksum_engine_find (g_strstrip (*n));
+
+    if (!engine) {
+      g_printerr ("unknown checksum type '%s'\n", *n);
+      ret = FALSE;
+      break;
+    }
+    *hashes |= 1 << engine->type;
+  }
+  g_strfreev (names);
+
+  return ret && *hashes != 0;
+}
+
+/* Maps the Y4M colorspace tag to a video format, C420jpeg being the
+ * default */
+static GstVideoFormat
+y4m_format (const gchar * tag)
+{
+  static const struct
+  {
+    const gchar *tag;
+    GstVideoFormat format;
+  } formats[] = {
+    {"420jpeg", GST_VIDEO_FORMAT_I420},
+    {"420paldv", GST_VIDEO_FORMAT_I420},
+    {"420mpeg2", GST_VIDEO_FORMAT_I420},
+    {"420", GST_VIDEO_FORMAT_I420},
+    {"422", GST_VIDEO_FORMAT_Y42B},
+    {"444", GST_VIDEO_FORMAT_Y444},
+    {"mono", GST_VIDEO_FORMAT_GRAY8},
+    {"420p10", GST_VIDEO_FORMAT_I420_10LE},
+    {"422p10", GST_VIDEO_FORMAT_I422_10LE},
+    {"444p10", GST_VIDEO_FORMAT_Y444_10LE},
+  };
+  guint i;
+
+  if (!tag)
+    return GST_VIDEO_FORMAT_I420;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    if (strcmp (formats[i].tag, tag) == 0)
+      return formats[i].format;
+  }
+  return GST_VIDEO_FORMAT_UNKNOWN;
+}
+
+/* Parses the stream header and locates the frames of a Y4M file */
+static gboolean
+setup_y4m (CksumJob * job)
+{
+  const gchar *data = (const gchar *) job->data;
+  const gchar *end = data + job->size;
+  const gchar *nl;
+  gchar *header, **params, **p;
+  gchar *colorspace = NULL;
+  gint width = 0, height = 0;
+  GstCksumPlanes planes;
+  GstVideoFormat format;
+  gsize pos;
+
+  nl = memchr (data, '\n', job->size);
+  if (!nl) {
+    g_printerr ("truncated Y4M header\n");
+    return FALSE;
+  }
+
+  header = g_strndup (data + strlen (Y4M_MAGIC),
+      nl - data - strlen (Y4M_MAGIC));
+  params = g_strsplit (header, " ", -1);
+  for (p = params; *p; p++) {
+    switch ((*p)[0]) {
+      case 'W':
+        width = atoi (*p + 1);
+        break;
+      case 'H':
+        height = atoi (*p + 1);
+        break;
+      case 'C':
+        g_free (colorspace);
+        colorspace = g_strdup (*p + 1);
+        break;
+      default:
+        break;
+    }
+  }
+  g_strfreev (params);
+  g_free (header);
+
+  format = y4m_format (colorspace);
+  if (format == GST_VIDEO_FORMAT_UNKNOWN || width <= 0 || height <= 0) {
+    g_printerr ("unsupported Y4M stream %dx%d C%s\n", width, height,
+        colorspace ? colorspace : "420jpeg");
+    g_free (colorspace);
+    return FALSE;
+  }
+  g_free (colorspace);
+
+  gst_video_info_set_format (&job->info, format, width, height);
+  job->frame_size = gst_cksum_planes_init_packed (&planes, &job->info,
+      job->data);
+
+  pos = nl + 1 - data;
+  while (pos < job->size) {
+    if (job->size - pos < strlen (Y4M_FRAME)
+        || memcmp (data + pos, Y4M_FRAME, strlen (Y4M_FRAME)) != 0) {
+      g_printerr ("bad frame header at offset %" G_GSIZE_FORMAT "\n", pos);
+      return FALSE;
+    }
+    nl = memchr (data + pos, '\n', end - (data + pos));
+    if (!nl || (gsize) (end - nl - 1) < job->frame_size) {
+      g_printerr ("truncated frame at offset %" G_GSIZE_FORMAT "\n", pos);
+      break;
+    }
+    pos = nl + 1 - data;
+    g_array_append_val (job->offsets, pos);
+    pos += job->frame_size;
+  }
+
+  return TRUE;
+}
+
+/* Locates the frames of a raw file, packed as checksumsink dumps them */
+static gboolean
+setup_raw (CksumJob * job)
+{
+  GstCksumPlanes planes;
+  GstVideoFormat format;
+  gint width, height;
+  gsize pos;
+
+  if (!opt_format || !opt_size) {
+    g_printerr ("raw files need --format and --size\n");
+    return FALSE;
+  }
+
+  format = gst_video_format_from_string (opt_format);
+  if (format == GST_VIDEO_FORMAT_UNKNOWN) {
+    g_printerr ("unknown video format '%s'\n", opt_format);
+    return FALSE;
+  }
+  if (sscanf (opt_size, "%dx%d", &width, &height) != 2 || width <= 0
+      || height <= 0) {
+    g_printerr ("bad frame size '%s'\n", opt_size);
+    return FALSE;
+  }
+
+  gst_video_info_set_format (&job->info, format, width, height);
+  job->frame_size = gst_cksum_planes_init_packed (&planes, &job->info,
+      job->data);
+
+  for (pos = 0; pos + job->frame_size <= job->size; pos += job->frame_size)
+    g_array_append_val (job->offsets, pos);
+
+  if (pos != job->size)
+    g_printerr ("ignoring %" G_GSIZE_FORMAT " trailing bytes\n",
+        job->size - pos);
+
+  return TRUE;
+}
+
+/* Hashes the frames [first, last) of the current batch */
+static void
+hash_frames (gpointer data, gpointer user_data)
+{
+  CksumTask *task = data;
+  CksumJob *job = task->job;
+  GstCksumHasher *frame_ctx[GST_CKSUM_N_HASHES] = { NULL, };
+  GstCksumHasher *plane_ctx[GST_CKSUM_N_HASHES][GST_VIDEO_MAX_PLANES] = {
+    {NULL,},
+  };
+  gchar plane_csum[GST_CKSUM_N_HASHES][GST_VIDEO_MAX_PLANES]
+      [GST_CKSUM_MAX_HEX_SIZE];
+  gchar frame_csum[GST_CKSUM_N_HASHES][GST_CKSUM_MAX_HEX_SIZE];
+  GstCksumPlanes planes;
+  GstCksumWalker walker;
+  guint i, t, n, plane, n_planes;
+
+  n_planes = GST_VIDEO_INFO_N_PLANES (&job->info);
+
+  for (i = task->first; i < task->last; i++) {
+    gsize offset = g_array_index (job->offsets, gsize, job->batch_start + i);
+
+    gst_cksum_planes_init_packed (&planes, &job->info, job->data + offset);
+
+    memset (&walker, 0, sizeof (GstCksumWalker));
+    for (t = 0, n = 0; t < GST_CKSUM_N_HASHES; t++) {
+      if (!(job->hashes & (1 << t)))
+        continue;
+      if (job->frame_checksum) {
+        if (!frame_ctx[t])
+          frame_ctx[t] = gst_cksum_hasher_new (t);
+        gst_cksum_hasher_reset (frame_ctx[t]);
+        walker.frame[n] = frame_ctx[t];
+      }
+      for (plane = 0; job->plane_checksum && plane < n_planes; plane++) {
+        if (!plane_ctx[t][plane])
+          plane_ctx[t][plane] = gst_cksum_hasher_new (t);
+        gst_cksum_hasher_reset (plane_ctx[t][plane]);
+        walker.plane[plane][n] = plane_ctx[t][plane];
+      }
+      n++;
+    }
+    walker.n_hashers = n;
+
+    gst_cksum_walk_planes (&planes, NULL, &walker);
+
+    for (t = 0; t < GST_CKSUM_N_HASHES; t++) {
+      if (frame_ctx[t] && (job->hashes & (1 << t)))
+        gst_cksum_hasher_final_string (frame_ctx[t], frame_csum[t]);
+      for (plane = 0; plane < n_planes; plane++) {
+        if (plane_ctx[t][plane] && (job->hashes & (1 << t)))
+          gst_cksum_hasher_final_string (plane_ctx[t][plane],
+              plane_csum[t][plane]);
+      }
+    }
+
+    gst_cksum_format_frame_checksums (job->text[i], job->hashes,
+        job->plane_checksum, job->frame_checksum, plane_csum, frame_csum,
+        n_planes);
+  }
+
+  for (t = 0; t < GST_CKSUM_N_HASHES; t++) {
+    gst_cksum_hasher_free (frame_ctx[t]);
+    for (plane = 0; plane < GST_VIDEO_MAX_PLANES; plane++)
+      gst_cksum_hasher_free (plane_ctx[t][plane]);
+  }
+
+  g_mutex_lock (&job->lock);
+  if (--job->pending == 0)
+    g_cond_signal (&job->cond);
+  g_mutex_unlock (&job->lock);
+}
+
+static gboolean
+process_file (const gchar * filename, guint n_threads)
+{
+  CksumJob job = { {0}, };
+  CksumTask *tasks;
+  GThreadPool *pool;
+  struct stat st;
+  gpointer map;
+  gboolean ret = FALSE;
+  guint n_frames, i;
+  int fd;
+
+  fd = open (filename, O_RDONLY);
+  if (fd < 0 || fstat (fd, &st) < 0) {
+    g_printerr ("%s: %s\n", filename, g_strerror (errno));
+    if (fd >= 0)
+      close (fd);
+    return FALSE;
+  }
+  if (st.st_size == 0) {
+    close (fd);
+    return TRUE;
+  }
+
+  map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED) {
+    g_printerr ("%s: %s\n", filename, g_strerror (errno));
+    return FALSE;
+  }
+  /* frames are read once, front to back */
+  madvise (map, st.st_size, MADV_SEQUENTIAL);
+
+  job.data = map;
+  job.size = st.st_size;
+  job.offsets = g_array_new (FALSE, FALSE, sizeof (gsize));
+  if (!parse_hashes (opt_hash, &job.hashes))
+    goto done;
+  job.plane_checksum = opt_plane_checksum;
+  job.frame_checksum = opt_frame_checksum;
+
+  if (job.size >= strlen (Y4M_MAGIC)
+      && memcmp (job.data, Y4M_MAGIC, strlen (Y4M_MAGIC)) == 0) {
+    if (!setup_y4m (&job))
+      goto done;
+  } else if (!setup_raw (&job)) {
+    goto done;
+  }
+
+  g_mutex_init (&job.lock);
+  g_cond_init (&job.cond);
+  job.text = g_malloc (BATCH_FRAMES * GST_CKSUM_FRAME_TEXT_SIZE);
+  tasks = g_new (CksumTask, n_threads);
+  pool = g_thread_pool_new (hash_frames, NULL, n_threads, TRUE, NULL);
+
+  n_frames = job.offsets->len;
+  for (job.batch_start = 0; job.batch_start < n_frames;
+      job.batch_start += job.batch_len) {
+    guint n_tasks = 0;
+
+    job.batch_len = MIN (BATCH_FRAMES, n_frames - job.batch_start);
+
+    /* contiguous runs of frames, one per thread */
+    g_mutex_lock (&job.lock);
+    for (i = 0; i < n_threads; i++) {
+      guint first = job.batch_len * i / n_threads;
+      guint last = job.batch_len * (i + 1) / n_threads;
+
+      if (first == last)
+        continue;
+      tasks[n_tasks].job = &job;
+      tasks[n_tasks].first = first;
+      tasks[n_tasks].last = last;
+      n_tasks++;
+    }
+    job.pending = n_tasks;
+    for (i = 0; i < n_tasks; i++)
+      g_thread_pool_push (pool, &tasks[i], NULL);
+    while (job.pending > 0)
+      g_cond_wait (&job.cond, &job.lock);
+    g_mutex_unlock (&job.lock);
+
+    for (i = 0; i < job.batch_len; i++)
+      fputs (job.text[i], stdout);
+  }
+  fflush (stdout);
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (tasks);
+  g_free (job.text);
+  g_mutex_clear (&job.lock);
+  g_cond_clear (&job.cond);
+  ret = TRUE;
+
+done:
+  g_array_unref (job.offsets);
+  munmap (map, st.st_size);
+
+  return ret;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint n_threads;
+  gint i, ret = 0;
+
+  ctx = g_option_context_new ("FILE... - print the checksums of raw video "
+      "and Y4M frames as checksumsink does");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc < 2) {
+    g_printerr ("no input file\n");
+    return 1;
+  }
+
+  /* only for the video format tables, no pipeline is built */
+  gst_init (NULL, NULL);
+
+  n_threads = opt_threads > 0 ? opt_threads : g_get_num_processors ();
+
+  for (i = 1; i < argc; i++) {
+    if (!process_file (argv[i], n_threads))
+      ret = 1;
+  }
+
+  return ret;
+}
@@ -0,0 +1,385 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Decoded picture hash SEI of H.265 and H.266: parsing the SEI and
+ * computing the digests it carries for a decoded picture */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstcksumdph.h"
+
+#define SEI_DECODED_PICTURE_HASH 132
+
+#define H265_NAL_PREFIX_SEI 39
+#define H265_NAL_SUFFIX_SEI 40
+#define H266_NAL_PREFIX_SEI 23
+#define H266_NAL_SUFFIX_SEI 24
+
+gsize
+gst_cksum_dph_digest_size (GstCksumDphType type)
+{
+  static const gsize sizes[GST_CKSUM_DPH_N_TYPES] = { 16, 2, 4 };
+
+  return sizes[type];
+}
+
+/* The digests are defined on the samples of each component stored on
+ * one byte, or on two in little endian above 8 bits, which is how
+ * planar formats with one component per plane hold them in memory. */
+gboolean
+gst_cksum_dph_supports_format (const GstVideoInfo * info)
+{
+  const GstVideoFormatInfo *finfo = info->finfo;
+  guint comp, bps, n_components;
+
+  if (GST_VIDEO_FORMAT_INFO_IS_TILED (finfo))
+    return FALSE;
+  if (!GST_VIDEO_FORMAT_INFO_IS_YUV (finfo)
+      && !GST_VIDEO_FORMAT_INFO_IS_GRAY (finfo))
+    return FALSE;
+
+  n_components = MIN (GST_VIDEO_INFO_N_COMPONENTS (info),
+      GST_CKSUM_DPH_MAX_COMPONENTS);
+  for (comp = 0; comp < n_components; comp++) {
+    bps = GST_VIDEO_FORMAT_INFO_DEPTH (finfo, comp) > 8 ? 2 : 1;
+    if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, comp) != comp
+        || GST_VIDEO_FORMAT_INFO_POFFSET (finfo, comp) != 0
+        || GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, comp) != bps
+        || GST_VIDEO_FORMAT_INFO_SHIFT (finfo, comp) != 0)
+      return FALSE;
+    if (bps == 2 && !GST_VIDEO_FORMAT_INFO_IS_LE (finfo))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* CRC engine: CRC-16 with polynomial 0x1021, starting from 0xffff and
+ * fed the bytes of the samples most significant bit first, followed by
+ * 16 zero bits */
+
+typedef struct
+{
+  GstCksumHasher parent;
+  guint16 crc;
+} CrcHasher;
+
+static guint16 crc16_table[256];
+
+static gpointer
+init_crc16_table (gpointer data)
+{
+  guint i, j, c;
+
+  for (i = 0; i < 256; i++) {
+    c = i << 8;
+    for (j = 0; j < 8; j++)
+      c = (c & 0x8000) ? (c << 1) ^ 0x1021 : c << 1;
+    crc16_table[i] = c;
+  }
+
+  return NULL;
+}
+
+static GstCksumHasher *
+crc_init (const GstCksumEngine * engine)
+{
+  static GOnce once = G_ONCE_INIT;
+  CrcHasher *hasher = g_new (CrcHasher, 1);
+
+  g_once (&once, init_crc16_table, NULL);
+
+  hasher->parent.engine = engine;
+  hasher->crc = 0xffff;
+  return &hasher->parent;
+}
+
+static void
+crc_reset (GstCksumHasher * hasher)
+{
+  ((CrcHasher *) hasher)->crc = 0xffff;
+}
+
+static void
+crc_update (GstCksumHasher * hasher, const guint8 * data, gsize len)
+{
+  CrcHasher *h = (CrcHasher *) hasher;
+  guint16 crc = h->crc;
+  gsize i;
+
+  /* the data enters on the low bits, so only the high byte feeds back */
+  for (i = 0; i < len; i++)
+    crc = ((crc << 8) | data[i]) ^ crc16_table[crc >> 8];
+  h->crc = crc;
+}
+
+static void
+crc_final (GstCksumHasher * hasher, guint8 * digest)
+{
+  static const guint8 zeros[2] = { 0, 0 };
+  guint16 crc;
+
+  crc_update (hasher, zeros, sizeof (zeros));
+  crc = GUINT16_TO_BE (((CrcHasher *) hasher)->crc);
+  memcpy (digest, &crc, sizeof (crc));
+}
+
+/* checksum engine: sum of the bytes of the samples, each XORed with a
+ * mask of the sample position. Every update must be a whole row. */
+
+typedef struct
+{
+  GstCksumHasher parent;
+  guint32 sum;
+  guint y;
+  guint bps;
+} SumHasher;
+
+static GstCksumHasher *
+sum_init (const GstCksumEngine * engine)
+{
+  SumHasher *hasher = g_new0 (SumHasher, 1);
+
+  hasher->parent.engine = engine;
+  hasher->bps = 1;
+  return &hasher->parent;
+}
+
+static void
+sum_reset (GstCksumHasher * hasher)
+{
+  SumHasher *h = (SumHasher *) hasher;
+
+  h->sum = 0;
+  h->y = 0;
+}
+
+static void
+sum_update (GstCksumHasher * hasher, const guint8 * data, gsize len)
+{
+  SumHasher *h = (SumHasher *) hasher;
+  guint32 sum = h->sum;
+  guint y = h->y, x, mask;
+  gsize width = len / h->bps;
+
+  for (x = 0; x < width; x++) {
+    mask = (x & 0xff) ^ (y & 0xff) ^ (x >> 8) ^ (y >> 8);
+    sum += data[0] ^ mask;
+    if (h->bps == 2)
+      sum += data[1] ^ mask;
+    data += h->bps;
+  }
+
+  h->sum = sum;
+  h->y++;
+}
+
+static void
+sum_final (GstCksumHasher * hasher, guint8 * digest)
+{
+  guint32 sum = GUINT32_TO_BE (((SumHasher *) hasher)->sum);
+
+  memcpy (digest, &sum, sizeof (sum));
+}
+
+static GstCksumHasher *
+struct_clone (const GstCksumHasher * hasher)
+{
+  gsize size = GPOINTER_TO_SIZE (hasher->engine->data);
+  GstCksumHasher *copy = g_malloc (size);
+
+  memcpy (copy, hasher, size);
+  return copy;
+}
+
+static void
+struct_free (GstCksumHasher * hasher)
+{
+  g_free (hasher);
+}
+
+/* not part of the registry of the hash types of the sink */
+static const GstCksumEngine crc_engine = {
+  GST_CKSUM_N_HASHES, "crc", 2, crc_init, crc_reset, crc_update, crc_final,
+  struct_clone, struct_free, NULL, NULL, GSIZE_TO_POINTER (sizeof (CrcHasher))
+};
+
+static const GstCksumEngine sum_engine = {
+  GST_CKSUM_N_HASHES, "checksum", 4, sum_init, sum_reset, sum_update,
+  sum_final, struct_clone, struct_free, NULL, NULL,
+  GSIZE_TO_POINTER (sizeof (SumHasher))
+};
+
+/* Returns a hasher computing the digest of @type of a component of the
+ * pictures of @info, to be fed its rows one at a time */
+GstCksumHasher *
+gst_cksum_dph_hasher_new (GstCksumDphType type, const GstVideoInfo * info)
+{
+  GstCksumHasher *hasher;
+
+  switch (type) {
+    case GST_CKSUM_DPH_CRC:
+      return crc_engine.init (&crc_engine);
+    case GST_CKSUM_DPH_CHECKSUM:
+      hasher = sum_engine.init (&sum_engine);
+      if (GST_VIDEO_FORMAT_INFO_DEPTH (info->finfo, 0) > 8)
+        ((SumHasher *) hasher)->bps = 2;
+      return hasher;
+    case GST_CKSUM_DPH_MD5:
+    default:
+      return gst_cksum_hasher_new (GST_CKSUM_HASH_MD5);
+  }
+}
+
+static const guint8 *
+find_start_code (const guint8 * p, const guint8 * end)
+{
+  while (end - p >= 3) {
+    if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+      return p;
+    p++;
+  }
+  return end;
+}
+
+static gboolean
+is_sei (const guint8 * nal, gboolean vvc)
+{
+  guint type;
+
+  if (vvc) {
+    type = nal[1] >> 3;
+    return type == H266_NAL_PREFIX_SEI || type == H266_NAL_SUFFIX_SEI;
+  }
+
+  type = (nal[0] >> 1) & 0x3f;
+  return type == H265_NAL_PREFIX_SEI || type == H265_NAL_SUFFIX_SEI;
+}
+
+/* Copies the payload of a NAL unit to @rbsp without its emulation
+ * prevention bytes. Returns the size of @rbsp. */
+static gsize
+nal_to_rbsp (const guint8 * nal, gsize size, guint8 * rbsp)
+{
+  guint zeros = 0;
+  gsize i, n = 0;
+
+  for (i = 0; i < size; i++) {
+    if (zeros >= 2 && nal[i] == 3) {
+      zeros = 0;
+      continue;
+    }
+    zeros = nal[i] == 0 ? zeros + 1 : 0;
+    rbsp[n++] = nal[i];
+  }
+
+  return n;
+}
+
+/* H.266 adds a byte holding dph_sei_single_component_flag after the
+ * hash type; H.265 has one component for 4:0:0 and three otherwise */
+static gboolean
+parse_dph_payload (const guint8 * p, gsize size, gboolean vvc,
+    GstCksumDph * dph)
+{
+  gsize header = vvc ? 2 : 1;
+  gsize digest_size;
+  guint i, n;
+
+  if (size < header || p[0] >= GST_CKSUM_DPH_N_TYPES)
+    return FALSE;
+
+  dph->type = p[0];
+  digest_size = gst_cksum_dph_digest_size (dph->type);
+  if (vvc)
+    n = (p[1] & 0x80) ? 1 : 3;
+  else
+    n = (size - header) / digest_size;
+  if ((n != 1 && n != 3) || size < header + n * digest_size)
+    return FALSE;
+
+  dph->n_components = n;
+  for (i = 0; i < n; i++)
+    memcpy (dph->digest[i], p + header + i * digest_size, digest_size);
+
+  return TRUE;
+}
+
+static gboolean
+parse_sei (const guint8 * p, gsize size, gboolean vvc, GstCksumDph * dph)
+{
+  const guint8 *end = p + size;
+  guint type, len;
+
+  /* the last byte is rbsp_trailing_bits */
+  while (end - p > 1) {
+    type = len = 0;
+    while (p < end && *p == 0xff)
+      type += *p++;
+    if (p == end)
+      return FALSE;
+    type += *p++;
+    while (p < end && *p == 0xff)
+      len += *p++;
+    if (p == end)
+      return FALSE;
+    len += *p++;
+    if (len > (gsize) (end - p))
+      return FALSE;
+
+    if (type == SEI_DECODED_PICTURE_HASH)
+      return parse_dph_payload (p, len, vvc, dph);
+    p += len;
+  }
+
+  return FALSE;
+}
+
+/* Looks for a decoded picture hash SEI in the byte-stream access unit
+ * @data. Returns FALSE if there is none. The SEI payloads are unescaped
+ * into @rbsp, which is grown as needed and can be reused across calls. */
+gboolean
+gst_cksum_dph_parse (const guint8 * data, gsize size, gboolean vvc,
+    GByteArray * rbsp, GstCksumDph * dph)
+{
+  const guint8 *end = data + size;
+  const guint8 *nal, *next;
+  gboolean found = FALSE;
+  gsize len;
+
+  nal = find_start_code (data, end);
+  while (nal < end && !found) {
+    nal += 3;
+    next = find_start_code (nal, end);
+    if (next - nal > 2 && is_sei (nal, vvc)) {
+      if (rbsp->len < (guint) (next - nal))
+        g_byte_array_set_size (rbsp, next - nal);
+      len = nal_to_rbsp (nal + 2, next - nal - 2, rbsp->data);
+      found = parse_sei (rbsp->data, len, vvc, dph);
+    }
+    nal = next;
+  }
+
+  return found;
+}
@@ -0,0 +1,63 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef _GST_CKSUM_DPH_H_
+#define _GST_CKSUM_DPH_H_
+
+#include <gst/video/video.h>
+
+#include "gstcksumhasher.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstCksumDph GstCksumDph;
+
+/* components a decoded picture hash SEI covers at most */
+#define GST_CKSUM_DPH_MAX_COMPONENTS 3
+
+/* values of hash_type in the decoded picture hash SEI of H.265 and
+ * H.266 */
+typedef enum
+{
+  GST_CKSUM_DPH_MD5,
+  GST_CKSUM_DPH_CRC,
+  GST_CKSUM_DPH_CHECKSUM,
+  GST_CKSUM_DPH_N_TYPES
+} GstCksumDphType;
+
+/* the digests of a decoded picture, in the byte order of the SEI */
+struct _GstCksumDph
+{
+  GstCksumDphType type;
+  guint n_components;
+  guint8 digest[GST_CKSUM_DPH_MAX_COMPONENTS][16];
+};
+
+gsize gst_cksum_dph_digest_size (GstCksumDphType type);
+gboolean gst_cksum_dph_supports_format (const GstVideoInfo * info);
+GstCksumHasher *gst_cksum_dph_hasher_new (GstCksumDphType type,
+    const GstVideoInfo * info);
+
+gboolean gst_cksum_dph_parse (const guint8 * data, gsize size, gboolean vvc,
+    GByteArray * rbsp, GstCksumDph * dph);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,308 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Non-cryptographic hashes, cheap enough to run on every frame */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstcksumfast.h"
+
+/* CRC-32, reflected polynomial 0xEDB88320, computed 8 bytes at a time
+ * with the slicing-by-8 tables */
+
+static guint32 crc32_table[8][256];
+
+static gpointer
+init_crc32_table (gpointer data)
+{
+  guint32 i, j, c;
+
+  for (i = 0; i < 256; i++) {
+    c = i;
+    for (j = 0; j < 8; j++)
+      c = (c & 1) ? (c >> 1) ^ 0xEDB88320 : c >> 1;
+    crc32_table[0][i] = c;
+  }
+  for (i = 0; i < 256; i++) {
+    c = crc32_table[0][i];
+    for (j = 1; j < 8; j++) {
+      c = crc32_table[0][c & 0xff] ^ (c >> 8);
+      crc32_table[j][i] = c;
+    }
+  }
+
+  return NULL;
+}
+
+guint32
+gst_cksum_crc32_update (guint32 crc, const guint8 * data, gsize len)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  g_once (&once, init_crc32_table, NULL);
+
+  crc = ~crc;
+
+  while (len > 0 && ((guintptr) data & 7) != 0) {
+    crc = crc32_table[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    len--;
+  }
+
+  while (len >= 8) {
+    guint32 lo, hi;
+
+    memcpy (&lo, data, 4);
+    memcpy (&hi, data + 4, 4);
+    lo = GUINT32_FROM_LE (lo) ^ crc;
+    hi = GUINT32_FROM_LE (hi);
+    crc = crc32_table[7][lo & 0xff] ^
+        crc32_table[6][(lo >> 8) & 0xff] ^
+        crc32_table[5][(lo >> 16) & 0xff] ^
+        crc32_table[4][lo >> 24] ^
+        crc32_table[3][hi & 0xff] ^
+        crc32_table[2][(hi >> 8) & 0xff] ^
+        crc32_table[1][(hi >> 16) & 0xff] ^ crc32_table[0][hi >> 24];
+    data += 8;
+    len -= 8;
+  }
+
+  while (len > 0) {
+    crc = crc32_table[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    len--;
+  }
+
+  return ~crc;
+}
+
+/* Returns the CRC-32 of the concatenation of two blocks from their
+ * CRCs and the length of the second one, by applying len2 zero bytes to
+ * crc1 with the squared operator matrices, as zlib's crc32_combine() */
+
+static guint32
+gf2_matrix_times (const guint32 * mat, guint32 vec)
+{
+  guint32 sum = 0;
+
+  while (vec) {
+    if (vec & 1)
+      sum ^= *mat;
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+static void
+gf2_matrix_square (guint32 * square, const guint32 * mat)
+{
+  guint n;
+
+  for (n = 0; n < 32; n++)
+    square[n] = gf2_matrix_times (mat, mat[n]);
+}
+
+guint32
+gst_cksum_crc32_combine (guint32 crc1, guint32 crc2, guint64 len2)
+{
+  guint32 even[32], odd[32];
+  guint32 row;
+  guint n;
+
+  if (len2 == 0)
+    return crc1;
+
+  /* operator for one zero bit */
+  odd[0] = 0xEDB88320;
+  row = 1;
+  for (n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+
+  /* operators for two and four zero bits */
+  gf2_matrix_square (even, odd);
+  gf2_matrix_square (odd, even);
+
+  do {
+    gf2_matrix_square (even, odd);
+    if (len2 & 1)
+      crc1 = gf2_matrix_times (even, crc1);
+    len2 >>= 1;
+    if (len2 == 0)
+      break;
+
+    gf2_matrix_square (odd, even);
+    if (len2 & 1)
+      crc1 = gf2_matrix_times (odd, crc1);
+    len2 >>= 1;
+  } while (len2 != 0);
+
+  return crc1 ^ crc2;
+}
+
+/* XXH64, as specified by the xxHash reference implementation */
+
+#define XXH_PRIME64_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define XXH_PRIME64_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define XXH_PRIME64_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+#define XXH_PRIME64_4 G_GUINT64_CONSTANT (0x85EBCA77C2B2AE63)
+#define XXH_PRIME64_5 G_GUINT64_CONSTANT (0x27D4EB2F165667C5)
+
+#define XXH_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline guint64
+xxh_read64 (const guint8 * p)
+{
+  guint64 v;
+
+  memcpy (&v, p, 8);
+  return GUINT64_FROM_LE (v);
+}
+
+static inline guint32
+xxh_read32 (const guint8 * p)
+{
+  guint32 v;
+
+  memcpy (&v, p, 4);
+  return GUINT32_FROM_LE (v);
+}
+
+static inline guint64
+xxh64_round (guint64 acc, guint64 input)
+{
+  acc += input * XXH_PRIME64_2;
+  acc = XXH_ROTL64 (acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+static inline guint64
+xxh64_merge_round (guint64 acc, guint64 val)
+{
+  acc ^= xxh64_round (0, val);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+void
+gst_cksum_xxh64_init (GstCksumXxh64 * state, guint64 seed)
+{
+  memset (state, 0, sizeof (GstCksumXxh64));
+  state->seed = seed;
+  state->v[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+  state->v[1] = seed + XXH_PRIME64_2;
+  state->v[2] = seed;
+  state->v[3] = seed - XXH_PRIME64_1;
+}
+
+void
+gst_cksum_xxh64_update (GstCksumXxh64 * state, const guint8 * data, gsize len)
+{
+  const guint8 *end = data + len;
+
+  state->total_len += len;
+
+  if (state->mem_size + len < 32) {
+    memcpy (state->mem + state->mem_size, data, len);
+    state->mem_size += len;
+    return;
+  }
+
+  if (state->mem_size > 0) {
+    guint fill = 32 - state->mem_size;
+
+    memcpy (state->mem + state->mem_size, data, fill);
+    state->v[0] = xxh64_round (state->v[0], xxh_read64 (state->mem));
+    state->v[1] = xxh64_round (state->v[1], xxh_read64 (state->mem + 8));
+    state->v[2] = xxh64_round (state->v[2], xxh_read64 (state->mem + 16));
+    state->v[3] = xxh64_round (state->v[3], xxh_read64 (state->mem + 24));
+    data += fill;
+    state->mem_size = 0;
+  }
+
+  if (end - data >= 32) {
+    guint64 v1 = state->v[0], v2 = state->v[1];
+    guint64 v3 = state->v[2], v4 = state->v[3];
+
+    do {
+      v1 = xxh64_round (v1, xxh_read64 (data));
+      v2 = xxh64_round (v2, xxh_read64 (data + 8));
+      v3 = xxh64_round (v3, xxh_read64 (data + 16));
+      v4 = xxh64_round (v4, xxh_read64 (data + 24));
+      data += 32;
+    } while (end - data >= 32);
+
+    state->v[0] = v1;
+    state->v[1] = v2;
+    state->v[2] = v3;
+    state->v[3] = v4;
+  }
+
+  if (data < end) {
+    memcpy (state->mem, data, end - data);
+    state->mem_size = end - data;
+  }
+}
+
+guint64
+gst_cksum_xxh64_digest (const GstCksumXxh64 * state)
+{
+  const guint8 *p = state->mem;
+  const guint8 *end = p + state->mem_size;
+  guint64 h;
+
+  if (state->total_len >= 32) {
+    h = XXH_ROTL64 (state->v[0], 1) + XXH_ROTL64 (state->v[1], 7) +
+        XXH_ROTL64 (state->v[2], 12) + XXH_ROTL64 (state->v[3], 18);
+    h = xxh64_merge_round (h, state->v[0]);
+    h = xxh64_merge_round (h, state->v[1]);
+    h = xxh64_merge_round (h, state->v[2]);
+    h = xxh64_merge_round (h, state->v[3]);
+  } else {
+    h = state->seed + XXH_PRIME64_5;
+  }
+
+  h += state->total_len;
+
+  while (p + 8 <= end) {
+    h ^= xxh64_round (0, xxh_read64 (p));
+    h = XXH_ROTL64 (h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= (guint64) xxh_read32 (p) * XXH_PRIME64_1;
+    h = XXH_ROTL64 (h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= (*p++) * XXH_PRIME64_5;
+    h = XXH_ROTL64 (h, 11) * XXH_PRIME64_1;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+
+  return h;
+}
@@ -0,0 +1,51 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_CKSUM_FAST_H_
+#define _GST_CKSUM_FAST_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstCksumXxh64 GstCksumXxh64;
+
+/* streaming state of XXH64 */
+struct _GstCksumXxh64
+{
+  guint64 v[4];
+  guint64 total_len;
+  guint8 mem[32];
+  guint mem_size;
+  guint64 seed;
+};
+
+/* CRC-32 as used by zlib and PNG: start with 0, feed the previous
+ * result back in to continue */
+guint32 gst_cksum_crc32_update (guint32 crc, const guint8 * data, gsize len);
+guint32 gst_cksum_crc32_combine (guint32 crc1, guint32 crc2, guint64 len2);
+
+void gst_cksum_xxh64_init (GstCksumXxh64 * state, guint64 seed);
+void gst_cksum_xxh64_update (GstCksumXxh64 * state, const guint8 * data,
+    gsize len);
+guint64 gst_cksum_xxh64_digest (const GstCksumXxh64 * state);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,164 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Digest of a whole file, read with large sequential reads and split
+ * across threads when the hash can combine the digests of chunks, which
+ * only CRC-32 does */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "gstcksumfile.h"
+
+/* size of the reads, a multiple of the page size */
+#define READ_SIZE (4 << 20)
+
+/* smallest chunk worth a thread of its own */
+#define MIN_CHUNK_SIZE (64 << 20)
+
+typedef struct
+{
+  gint fd;
+  const GstCksumEngine *engine;
+  guint64 offset;
+  guint64 size;
+  guint8 digest[GST_CKSUM_MAX_DIGEST_SIZE];
+  gint error;
+} HashChunk;
+
+/* Hashes chunk->size bytes at chunk->offset with positioned reads, so
+ * that threads can share the file descriptor */
+static gpointer
+hash_chunk (gpointer data)
+{
+  HashChunk *chunk = data;
+  GstCksumHasher *hasher;
+  guint64 offset = chunk->offset;
+  guint64 end = chunk->offset + chunk->size;
+  guint8 *buf;
+
+  hasher = chunk->engine->init (chunk->engine);
+  buf = g_malloc (READ_SIZE);
+
+  while (offset < end) {
+    ssize_t len = pread (chunk->fd, buf, MIN (READ_SIZE, end - offset),
+        offset);
+
+    if (len < 0 && errno == EINTR)
+      continue;
+    if (len <= 0) {
+      /* the file shrunk under us */
+      chunk->error = len < 0 ? errno : EIO;
+      break;
+    }
+    gst_cksum_hasher_update (hasher, buf, len);
+    offset += len;
+  }
+
+  gst_cksum_hasher_final (hasher, chunk->digest);
+  gst_cksum_hasher_free (hasher);
+  g_free (buf);
+
+  return NULL;
+}
+
+/* Computes the digest of @filename with the hash @type and writes its
+ * printable form into @str, which must hold GST_CKSUM_MAX_HEX_SIZE
+ * bytes. Up to @n_threads threads read and hash separate chunks of the
+ * file when the hash supports combining them. */
+gboolean
+gst_cksum_hash_file (const gchar * filename, GstCksumHashType type,
+    guint n_threads, gchar * str, GError ** error)
+{
+  const GstCksumEngine *engine = gst_cksum_engine_get (type);
+  HashChunk *chunks;
+  GThread **threads;
+  struct stat st;
+  guint64 chunk_size;
+  guint i, n_chunks;
+  gboolean ret = TRUE;
+  gint fd;
+
+  fd = g_open (filename, O_RDONLY, 0);
+  if (fd < 0 || fstat (fd, &st) < 0) {
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+        "failed to open %s: %s", filename, g_strerror (errno));
+    if (fd >= 0)
+      close (fd);
+    return FALSE;
+  }
+
+#ifdef HAVE_POSIX_FADVISE
+  /* larger readahead */
+  posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  n_chunks = 1;
+  if (engine->combine && n_threads > 1)
+    n_chunks = CLAMP (st.st_size / MIN_CHUNK_SIZE, 1, n_threads);
+  chunk_size = st.st_size / n_chunks;
+
+  chunks = g_new0 (HashChunk, n_chunks);
+  threads = g_new0 (GThread *, n_chunks);
+  for (i = 0; i < n_chunks; i++) {
+    chunks[i].fd = fd;
+    chunks[i].engine = engine;
+    chunks[i].offset = i * chunk_size;
+    chunks[i].size =
+        i + 1 < n_chunks ? chunk_size : st.st_size - chunks[i].offset;
+  }
+
+  /* the first chunk is hashed by the calling thread */
+  for (i = 1; i < n_chunks; i++)
+    threads[i] = g_thread_new ("cksumfile", hash_chunk, &chunks[i]);
+  hash_chunk (&chunks[0]);
+  for (i = 1; i < n_chunks; i++)
+    g_thread_join (threads[i]);
+
+  for (i = 0; i < n_chunks; i++) {
+    if (chunks[i].error) {
+      g_set_error (error, G_FILE_ERROR,
+          g_file_error_from_errno (chunks[i].error), "failed to read %s: %s",
+          filename, g_strerror (chunks[i].error));
+      ret = FALSE;
+      break;
+    }
+    if (i > 0)
+      engine->combine (chunks[0].digest, chunks[i].digest, chunks[i].size);
+  }
+
+  if (ret)
+    gst_cksum_engine_format (engine, chunks[0].digest, str);
+
+  g_free (threads);
+  g_free (chunks);
+  close (fd);
+
+  return ret;
+}
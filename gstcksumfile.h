@@ -0,0 +1,33 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef _GST_CKSUM_FILE_H_
+#define _GST_CKSUM_FILE_H_
+
+#include "gstcksumhasher.h"
+
+G_BEGIN_DECLS
+
+gboolean gst_cksum_hash_file (const gchar * filename, GstCksumHashType type,
+    guint n_threads, gchar * str, GError ** error);
+
+G_END_DECLS
+
+#endif
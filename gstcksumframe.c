@@ -0,0 +1,283 @@
+/* GStreamer
+ * Copyright (C) 2010 David Schleef <ds@schleef.org>
+ * Copyright (C) 2015 Sreerenj Balachandran <sreerenj.balachandran@intel.com>
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Walking the rows of a video frame, shared by the sink and the
+ * gst-cksum tool so that both print the same checksums */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstcksumframe.h"
+
+/* Returns the number of bytes of a row of @plane that are part of the
+ * picture, the rest of the stride being ignored */
+gsize
+gst_cksum_plane_row_size (const GstVideoInfo * info, guint plane)
+{
+  /* FIXME: assumes subsampling of component N is the same as
+   * plane N, which is currently true for all formats we have but
+   * it might not be in the future. */
+  gint w = GST_VIDEO_INFO_COMP_WIDTH (info, plane)
+      * GST_VIDEO_INFO_COMP_PSTRIDE (info, plane);
+  /* FIXME: workaround for complex formats like v210, UYVP and
+   * IYU1 that have pstride == 0 */
+  if (w == 0)
+    w = GST_VIDEO_INFO_PLANE_STRIDE (info, plane);
+  return w;
+}
+
+void
+gst_cksum_planes_init_frame (GstCksumPlanes * planes, GstVideoFrame * frame)
+{
+  guint plane;
+
+  planes->n_planes = GST_VIDEO_FRAME_N_PLANES (frame);
+  for (plane = 0; plane < planes->n_planes; plane++) {
+    planes->data[plane] = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+    planes->stride[plane] = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+    planes->row_size[plane] = gst_cksum_plane_row_size (&frame->info, plane);
+    planes->height[plane] = GST_VIDEO_FRAME_COMP_HEIGHT (frame, plane);
+  }
+}
+
+/* Sets up @planes for a frame of @info packed as the sink dumps it, the
+ * rows of each plane following each other without padding. Returns the
+ * size of the packed frame. */
+gsize
+gst_cksum_planes_init_packed (GstCksumPlanes * planes,
+    const GstVideoInfo * info, const guint8 * data)
+{
+  guint plane;
+
+  planes->n_planes = GST_VIDEO_INFO_N_PLANES (info);
+  for (plane = 0; plane < planes->n_planes; plane++) {
+    planes->row_size[plane] = gst_cksum_plane_row_size (info, plane);
+    planes->height[plane] = GST_VIDEO_INFO_COMP_HEIGHT (info, plane);
+  }
+  return gst_cksum_planes_pack (planes, planes, data);
+}
+
+/* Sets up @packed for the rows of @planes once packed at @data, as
+ * gst_cksum_walk_planes() copies them. Returns the packed size. */
+gsize
+gst_cksum_planes_pack (const GstCksumPlanes * planes,
+    GstCksumPlanes * packed, const guint8 * data)
+{
+  gsize offset = 0;
+  guint plane;
+
+  packed->n_planes = planes->n_planes;
+  for (plane = 0; plane < planes->n_planes; plane++) {
+    packed->data[plane] = data + offset;
+    packed->row_size[plane] = planes->row_size[plane];
+    packed->stride[plane] = planes->row_size[plane];
+    packed->height[plane] = planes->height[plane];
+    offset += gst_cksum_planes_get_size (packed, plane);
+  }
+  return offset;
+}
+
+/* size of @plane once packed */
+gsize
+gst_cksum_planes_get_size (const GstCksumPlanes * planes, guint plane)
+{
+  return planes->row_size[plane] * planes->height[plane];
+}
+
+/* Restricts @planes, set up for a frame of @info, to the rectangle of
+ * @width x @height at @x, @y. Returns FALSE, leaving @planes untouched,
+ * when the rectangle doesn't start on a whole pixel of every plane or
+ * when the format can't be cropped without repacking. */
+gboolean
+gst_cksum_planes_crop (GstCksumPlanes * planes, const GstVideoInfo * info,
+    guint x, guint y, guint width, guint height)
+{
+  const GstVideoFormatInfo *finfo = info->finfo;
+  GstVideoInfo cinfo;
+  guint plane, comp;
+
+  if (GST_VIDEO_FORMAT_INFO_IS_TILED (finfo))
+    return FALSE;
+  for (comp = 0; comp < GST_VIDEO_INFO_N_COMPONENTS (info); comp++) {
+    if (GST_VIDEO_INFO_COMP_PSTRIDE (info, comp) == 0)
+      return FALSE;
+    if (x & ((1 << GST_VIDEO_FORMAT_INFO_W_SUB (finfo, comp)) - 1)
+        || y & ((1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo, comp)) - 1))
+      return FALSE;
+  }
+  if (x + width > GST_VIDEO_INFO_WIDTH (info)
+      || y + height > GST_VIDEO_INFO_HEIGHT (info))
+    return FALSE;
+  if (!gst_video_info_set_format (&cinfo, GST_VIDEO_INFO_FORMAT (info),
+          width, height))
+    return FALSE;
+
+  /* same assumption on components and planes as the row size */
+  for (plane = 0; plane < planes->n_planes; plane++) {
+    planes->data[plane] +=
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, plane, y)
+        * planes->stride[plane]
+        + GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, plane, x)
+        * GST_VIDEO_INFO_COMP_PSTRIDE (info, plane);
+    planes->row_size[plane] = gst_cksum_plane_row_size (&cinfo, plane);
+    planes->height[plane] = GST_VIDEO_INFO_COMP_HEIGHT (&cinfo, plane);
+  }
+
+  return TRUE;
+}
+
+/* Keeps only the planes of @planes whose bit is set in @mask, in order.
+ * Returns the number of planes left. */
+guint
+gst_cksum_planes_select (GstCksumPlanes * planes, guint mask)
+{
+  guint plane, n = 0;
+
+  for (plane = 0; plane < planes->n_planes; plane++) {
+    if (!(mask & (1 << plane)))
+      continue;
+    planes->data[n] = planes->data[plane];
+    planes->stride[n] = planes->stride[plane];
+    planes->row_size[n] = planes->row_size[plane];
+    planes->height[n] = planes->height[plane];
+    n++;
+  }
+  planes->n_planes = n;
+
+  return n;
+}
+
+/* Sets @slice to @n_rows rows of @plane from @row, and no rows of the
+ * other planes, so that walking it feeds the hashers of that plane. */
+void
+gst_cksum_planes_slice (const GstCksumPlanes * planes, guint plane,
+    guint row, guint n_rows, GstCksumPlanes * slice)
+{
+  guint i;
+
+  *slice = *planes;
+  for (i = 0; i < planes->n_planes; i++)
+    slice->height[i] = 0;
+  slice->data[plane] = planes->data[plane] + row * planes->stride[plane];
+  slice->height[plane] = n_rows;
+}
+
+/* Feeds the rows of @planes to the hashers of @walker, copying them to
+ * @dest first unless it is NULL. Each row is hashed right after being
+ * copied, while still in cache, so the frame is read once whatever the
+ * number of hashers. Returns the packed size of the frame. */
+gsize
+gst_cksum_walk_planes (const GstCksumPlanes * planes, guint8 * dest,
+    const GstCksumWalker * walker)
+{
+  gsize size = 0;
+  guint plane, j, i;
+
+  for (plane = 0; plane < planes->n_planes; plane++) {
+    const guint8 *sp = planes->data[plane];
+    gsize w = planes->row_size[plane];
+    GstCksumHasher *const *plane_ctx = walker->plane[plane];
+
+    for (j = 0; j < planes->height[plane]; j++) {
+      const guint8 *row = sp;
+
+      if (dest) {
+        memcpy (dest, sp, w);
+        row = dest;
+        dest += w;
+      }
+      for (i = 0; i < walker->n_hashers; i++) {
+        if (plane_ctx[i])
+          gst_cksum_hasher_update (plane_ctx[i], row, w);
+        if (walker->frame[i])
+          gst_cksum_hasher_update (walker->frame[i], row, w);
+      }
+      sp += planes->stride[plane];
+      size += w;
+    }
+  }
+
+  return size;
+}
+
+static gchar *
+format_plane_checksums (gchar * p, const gchar * name,
+    gchar (*plane_csum)[GST_CKSUM_MAX_HEX_SIZE], guint n_planes)
+{
+  guint i;
+
+  if (name) {
+    p = g_stpcpy (p, name);
+    *p++ = ' ';
+  }
+
+  for (i = 0; i < n_planes; i++) {
+    p = g_stpcpy (p, plane_csum[i]);
+    *p++ = ' ';
+    *p++ = ' ';
+  }
+  *p++ = '\n';
+
+  return p;
+}
+
+/* Formats the checksum lines of a frame into @text, which must hold
+ * GST_CKSUM_FRAME_TEXT_SIZE bytes, for each hash type of @hashes. The
+ * digests are prefixed by the name of the hash when there are several
+ * of them. Returns the length of the text. */
+gsize
+gst_cksum_format_frame_checksums (gchar * text, guint hashes,
+    gboolean plane_checksum, gboolean frame_checksum,
+    gchar (*plane_csum)[GST_VIDEO_MAX_PLANES][GST_CKSUM_MAX_HEX_SIZE],
+    gchar (*frame_csum)[GST_CKSUM_MAX_HEX_SIZE], guint n_planes)
+{
+  gboolean named = (hashes & (hashes - 1)) != 0;
+  gchar *p = text;
+  guint t;
+
+  for (t = 0; t < GST_CKSUM_N_HASHES; t++) {
+    const gchar *name = gst_cksum_engine_get (t)->name;
+
+    if (!(hashes & (1 << t)))
+      continue;
+
+    if (plane_checksum)
+      p = format_plane_checksums (p, named ? name : NULL, plane_csum[t],
+          n_planes);
+
+    if (frame_checksum) {
+      p = g_stpcpy (p, "FrameChecksum ");
+      if (named) {
+        p = g_stpcpy (p, name);
+        *p++ = ' ';
+      }
+      p = g_stpcpy (p, frame_csum[t]);
+      *p++ = '\n';
+    }
+  }
+  *p = '\0';
+
+  return p - text;
+}
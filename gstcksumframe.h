@@ -0,0 +1,90 @@
+/* GStreamer
+ * Copyright (C) 2010 David Schleef <ds@schleef.org>
+ * Copyright (C) 2015 Sreerenj Balachandran <sreerenj.balachandran@intel.com>
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef _GST_CKSUM_FRAME_H_
+#define _GST_CKSUM_FRAME_H_
+
+#include <gst/video/video.h>
+
+#include "gstcksumhasher.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstCksumPlanes GstCksumPlanes;
+typedef struct _GstCksumWalker GstCksumWalker;
+
+/* hashers a walker can feed: the strong ones, a gate hash and the
+ * decoded picture hash */
+#define GST_CKSUM_WALK_MAX_HASHERS (GST_CKSUM_N_HASHES + 2)
+
+/* large enough for the checksum lines of a frame in any combination of
+ * hash types */
+#define GST_CKSUM_FRAME_TEXT_SIZE \
+    (GST_CKSUM_N_HASHES * ((GST_VIDEO_MAX_PLANES + 1) * \
+        (GST_CKSUM_MAX_HEX_SIZE + 2) + 32))
+
+/* the rows of the planes of a frame: row_size bytes of each row are
+ * hashed and packed, the rest of the stride is padding */
+struct _GstCksumPlanes
+{
+  guint n_planes;
+  const guint8 *data[GST_VIDEO_MAX_PLANES];
+  gsize stride[GST_VIDEO_MAX_PLANES];
+  gsize row_size[GST_VIDEO_MAX_PLANES];
+  guint height[GST_VIDEO_MAX_PLANES];
+};
+
+/* hashers fed with every row, frame[i] with all the planes and
+ * plane[p][i] with plane p only; any of them may be NULL */
+struct _GstCksumWalker
+{
+  guint n_hashers;
+  GstCksumHasher *frame[GST_CKSUM_WALK_MAX_HASHERS];
+  GstCksumHasher *plane[GST_VIDEO_MAX_PLANES][GST_CKSUM_WALK_MAX_HASHERS];
+};
+
+gsize gst_cksum_plane_row_size (const GstVideoInfo * info, guint plane);
+
+void gst_cksum_planes_init_frame (GstCksumPlanes * planes,
+    GstVideoFrame * frame);
+gsize gst_cksum_planes_init_packed (GstCksumPlanes * planes,
+    const GstVideoInfo * info, const guint8 * data);
+gsize gst_cksum_planes_pack (const GstCksumPlanes * planes,
+    GstCksumPlanes * packed, const guint8 * data);
+gsize gst_cksum_planes_get_size (const GstCksumPlanes * planes, guint plane);
+gboolean gst_cksum_planes_crop (GstCksumPlanes * planes,
+    const GstVideoInfo * info, guint x, guint y, guint width, guint height);
+guint gst_cksum_planes_select (GstCksumPlanes * planes, guint mask);
+void gst_cksum_planes_slice (const GstCksumPlanes * planes, guint plane,
+    guint row, guint n_rows, GstCksumPlanes * slice);
+
+gsize gst_cksum_walk_planes (const GstCksumPlanes * planes, guint8 * dest,
+    const GstCksumWalker * walker);
+
+gsize gst_cksum_format_frame_checksums (gchar * text, guint hashes,
+    gboolean plane_checksum, gboolean frame_checksum,
+    gchar (*plane_csum)[GST_VIDEO_MAX_PLANES][GST_CKSUM_MAX_HEX_SIZE],
+    gchar (*frame_csum)[GST_CKSUM_MAX_HEX_SIZE], guint n_planes);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,308 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Registry of the hash engines usable by the sink. Each engine
+ * implements the GstCksumEngine vtable; new ones only need an entry in
+ * the engines table and a GstCksumHashType value. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstcksumfast.h"
+#include "gstcksumhasher.h"
+
+void
+gst_cksum_format_hex (const guint8 * digest, gsize len, gchar * hex)
+{
+  static const gchar digits[] = "0123456789abcdef";
+  gsize i;
+
+  for (i = 0; i < len; i++) {
+    hex[2 * i] = digits[digest[i] >> 4];
+    hex[2 * i + 1] = digits[digest[i] & 0xf];
+  }
+  hex[2 * len] = '\0';
+}
+
+/* GChecksum engines */
+
+typedef struct
+{
+  GstCksumHasher parent;
+  GChecksum *csum;
+} ChecksumHasher;
+
+static GstCksumHasher *
+checksum_init (const GstCksumEngine * engine)
+{
+  ChecksumHasher *hasher = g_new (ChecksumHasher, 1);
+
+  hasher->parent.engine = engine;
+  hasher->csum = g_checksum_new (GPOINTER_TO_INT (engine->data));
+  return &hasher->parent;
+}
+
+static void
+checksum_reset (GstCksumHasher * hasher)
+{
+  g_checksum_reset (((ChecksumHasher *) hasher)->csum);
+}
+
+static void
+checksum_update (GstCksumHasher * hasher, const guint8 * data, gsize len)
+{
+  g_checksum_update (((ChecksumHasher *) hasher)->csum, data, len);
+}
+
+static void
+checksum_final (GstCksumHasher * hasher, guint8 * digest)
+{
+  gsize len = hasher->engine->digest_size;
+
+  g_checksum_get_digest (((ChecksumHasher *) hasher)->csum, digest, &len);
+}
+
+static GstCksumHasher *
+checksum_clone (const GstCksumHasher * hasher)
+{
+  ChecksumHasher *copy = g_new (ChecksumHasher, 1);
+
+  copy->parent.engine = hasher->engine;
+  copy->csum = g_checksum_copy (((const ChecksumHasher *) hasher)->csum);
+  return &copy->parent;
+}
+
+static void
+checksum_free (GstCksumHasher * hasher)
+{
+  g_checksum_free (((ChecksumHasher *) hasher)->csum);
+  g_free (hasher);
+}
+
+/* CRC-32 engine, the digest being the CRC in big endian */
+
+typedef struct
+{
+  GstCksumHasher parent;
+  guint32 crc;
+} Crc32Hasher;
+
+static GstCksumHasher *
+crc32_init (const GstCksumEngine * engine)
+{
+  Crc32Hasher *hasher = g_new0 (Crc32Hasher, 1);
+
+  hasher->parent.engine = engine;
+  return &hasher->parent;
+}
+
+static void
+crc32_reset (GstCksumHasher * hasher)
+{
+  ((Crc32Hasher *) hasher)->crc = 0;
+}
+
+static void
+crc32_update (GstCksumHasher * hasher, const guint8 * data, gsize len)
+{
+  Crc32Hasher *h = (Crc32Hasher *) hasher;
+
+  h->crc = gst_cksum_crc32_update (h->crc, data, len);
+}
+
+static void
+crc32_final (GstCksumHasher * hasher, guint8 * digest)
+{
+  guint32 crc = GUINT32_TO_BE (((Crc32Hasher *) hasher)->crc);
+
+  memcpy (digest, &crc, sizeof (crc));
+}
+
+static void
+crc32_combine (guint8 * digest, const guint8 * next, guint64 len)
+{
+  guint32 crc1, crc2;
+
+  memcpy (&crc1, digest, sizeof (crc1));
+  memcpy (&crc2, next, sizeof (crc2));
+  crc1 = gst_cksum_crc32_combine (GUINT32_FROM_BE (crc1),
+      GUINT32_FROM_BE (crc2), len);
+  crc1 = GUINT32_TO_BE (crc1);
+  memcpy (digest, &crc1, sizeof (crc1));
+}
+
+/* XXH64 engine, the digest being the hash in big endian as in the
+ * canonical representation of xxHash */
+
+typedef struct
+{
+  GstCksumHasher parent;
+  GstCksumXxh64 state;
+} Xxh64Hasher;
+
+static GstCksumHasher *
+xxh64_init (const GstCksumEngine * engine)
+{
+  Xxh64Hasher *hasher = g_new (Xxh64Hasher, 1);
+
+  hasher->parent.engine = engine;
+  gst_cksum_xxh64_init (&hasher->state, 0);
+  return &hasher->parent;
+}
+
+static void
+xxh64_reset (GstCksumHasher * hasher)
+{
+  gst_cksum_xxh64_init (&((Xxh64Hasher *) hasher)->state, 0);
+}
+
+static void
+xxh64_update (GstCksumHasher * hasher, const guint8 * data, gsize len)
+{
+  gst_cksum_xxh64_update (&((Xxh64Hasher *) hasher)->state, data, len);
+}
+
+static void
+xxh64_final (GstCksumHasher * hasher, guint8 * digest)
+{
+  guint64 h =
+      GUINT64_TO_BE (gst_cksum_xxh64_digest (&((Xxh64Hasher *) hasher)->state));
+
+  memcpy (digest, &h, sizeof (h));
+}
+
+/* engines whose state is a plain struct are cloned by copying it */
+static GstCksumHasher *
+struct_clone (const GstCksumHasher * hasher)
+{
+  gsize size = GPOINTER_TO_SIZE (hasher->engine->data);
+  GstCksumHasher *copy = g_malloc (size);
+
+  memcpy (copy, hasher, size);
+  return copy;
+}
+
+static void
+struct_free (GstCksumHasher * hasher)
+{
+  g_free (hasher);
+}
+
+#define CHECKSUM_ENGINE(type, name, size, checksum_type) \
+  { type, name, size, checksum_init, checksum_reset, checksum_update, \
+    checksum_final, checksum_clone, checksum_free, NULL, NULL, \
+    GINT_TO_POINTER (checksum_type) }
+
+static const GstCksumEngine engines[GST_CKSUM_N_HASHES] = {
+  CHECKSUM_ENGINE (GST_CKSUM_HASH_MD5, "md5", 16, G_CHECKSUM_MD5),
+  CHECKSUM_ENGINE (GST_CKSUM_HASH_SHA1, "sha1", 20, G_CHECKSUM_SHA1),
+  CHECKSUM_ENGINE (GST_CKSUM_HASH_SHA256, "sha256", 32, G_CHECKSUM_SHA256),
+  CHECKSUM_ENGINE (GST_CKSUM_HASH_SHA512, "sha512", 64, G_CHECKSUM_SHA512),
+  {GST_CKSUM_HASH_CRC32, "crc32", 4, crc32_init, crc32_reset, crc32_update,
+      crc32_final, struct_clone, struct_free, NULL, crc32_combine,
+      GSIZE_TO_POINTER (sizeof (Crc32Hasher))},
+  {GST_CKSUM_HASH_XXH64, "xxh64", 8, xxh64_init, xxh64_reset, xxh64_update,
+      xxh64_final, struct_clone, struct_free, NULL, NULL,
+      GSIZE_TO_POINTER (sizeof (Xxh64Hasher))},
+};
+
+const GstCksumEngine *
+gst_cksum_engine_get (GstCksumHashType type)
+{
+  g_return_val_if_fail (type < GST_CKSUM_N_HASHES, NULL);
+
+  return &engines[type];
+}
+
+const GstCksumEngine *
+gst_cksum_engine_find (const gchar * name)
+{
+  guint i;
+
+  for (i = 0; i < GST_CKSUM_N_HASHES; i++) {
+    if (g_ascii_strcasecmp (engines[i].name, name) == 0)
+      return &engines[i];
+  }
+  return NULL;
+}
+
+GstCksumHasher *
+gst_cksum_hasher_new (GstCksumHashType type)
+{
+  const GstCksumEngine *engine = gst_cksum_engine_get (type);
+
+  g_return_val_if_fail (engine != NULL, NULL);
+
+  return engine->init (engine);
+}
+
+void
+gst_cksum_hasher_reset (GstCksumHasher * hasher)
+{
+  hasher->engine->reset (hasher);
+}
+
+GstCksumHasher *
+gst_cksum_hasher_clone (const GstCksumHasher * hasher)
+{
+  return hasher->engine->clone (hasher);
+}
+
+void
+gst_cksum_hasher_free (GstCksumHasher * hasher)
+{
+  if (hasher)
+    hasher->engine->free (hasher);
+}
+
+/* Writes the digest into @digest, which must hold at least
+ * GST_CKSUM_MAX_DIGEST_SIZE bytes, and returns its size */
+gsize
+gst_cksum_hasher_final (GstCksumHasher * hasher, guint8 * digest)
+{
+  hasher->engine->final (hasher, digest);
+  return hasher->engine->digest_size;
+}
+
+/* Writes the printable digest into @str, which must hold at least
+ * GST_CKSUM_MAX_HEX_SIZE bytes */
+void
+gst_cksum_hasher_final_string (GstCksumHasher * hasher, gchar * str)
+{
+  guint8 digest[GST_CKSUM_MAX_DIGEST_SIZE];
+
+  gst_cksum_hasher_final (hasher, digest);
+  gst_cksum_engine_format (hasher->engine, digest, str);
+}
+
+/* Writes the printable form of @digest into @str, which must hold at
+ * least GST_CKSUM_MAX_HEX_SIZE bytes */
+void
+gst_cksum_engine_format (const GstCksumEngine * engine,
+    const guint8 * digest, gchar * str)
+{
+  if (engine->format)
+    engine->format (digest, engine->digest_size, str);
+  else
+    gst_cksum_format_hex (digest, engine->digest_size, str);
+}
@@ -0,0 +1,102 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef _GST_CKSUM_HASHER_H_
+#define _GST_CKSUM_HASHER_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstCksumEngine GstCksumEngine;
+typedef struct _GstCksumHasher GstCksumHasher;
+
+/* large enough for the longest digest we compute (SHA-512) */
+#define GST_CKSUM_MAX_DIGEST_SIZE 64
+#define GST_CKSUM_MAX_HEX_SIZE (2 * GST_CKSUM_MAX_DIGEST_SIZE + 1)
+
+/* the GChecksum based engines keep the values of their GChecksumType */
+typedef enum
+{
+  GST_CKSUM_HASH_MD5,
+  GST_CKSUM_HASH_SHA1,
+  GST_CKSUM_HASH_SHA256,
+  GST_CKSUM_HASH_SHA512,
+  GST_CKSUM_HASH_CRC32,
+  GST_CKSUM_HASH_XXH64,
+  GST_CKSUM_N_HASHES
+} GstCksumHashType;
+
+/* A hash implementation. init() returns a new hasher ready to be fed,
+ * final() writes digest_size bytes and leaves the hasher to be reset
+ * before reuse. format() prints a digest, and may be NULL for lowercase
+ * hex. combine(), if set, turns @digest into the digest of its data
+ * followed by the @len bytes whose digest is @next, so that chunks can be
+ * hashed in parallel; only CRC-32 has it. The state of a hasher can be
+ * cloned but not exported. */
+struct _GstCksumEngine
+{
+  GstCksumHashType type;
+  const gchar *name;
+  gsize digest_size;
+
+  GstCksumHasher *(*init) (const GstCksumEngine * engine);
+  void (*reset) (GstCksumHasher * hasher);
+  void (*update) (GstCksumHasher * hasher, const guint8 * data, gsize len);
+  void (*final) (GstCksumHasher * hasher, guint8 * digest);
+  GstCksumHasher *(*clone) (const GstCksumHasher * hasher);
+  void (*free) (GstCksumHasher * hasher);
+  void (*format) (const guint8 * digest, gsize len, gchar * str);
+  void (*combine) (guint8 * digest, const guint8 * next, guint64 len);
+
+  gpointer data;
+};
+
+/* first member of the state of every engine */
+struct _GstCksumHasher
+{
+  const GstCksumEngine *engine;
+};
+
+const GstCksumEngine *gst_cksum_engine_get (GstCksumHashType type);
+const GstCksumEngine *gst_cksum_engine_find (const gchar * name);
+
+GstCksumHasher *gst_cksum_hasher_new (GstCksumHashType type);
+void gst_cksum_hasher_reset (GstCksumHasher * hasher);
+GstCksumHasher *gst_cksum_hasher_clone (const GstCksumHasher * hasher);
+void gst_cksum_hasher_free (GstCksumHasher * hasher);
+gsize gst_cksum_hasher_final (GstCksumHasher * hasher, guint8 * digest);
+void gst_cksum_hasher_final_string (GstCksumHasher * hasher, gchar * str);
+
+void gst_cksum_engine_format (const GstCksumEngine * engine,
+    const guint8 * digest, gchar * str);
+
+static inline void
+gst_cksum_hasher_update (GstCksumHasher * hasher, const guint8 * data,
+    gsize len)
+{
+  hasher->engine->update (hasher, data, len);
+}
+
+void gst_cksum_format_hex (const guint8 * digest, gsize len, gchar * hex);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,116 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* gst-cksum-index: builds the binary index of a reference digest file,
+ * which checksumsink reads in place instead of parsing it.
+ *
+ *   gst-cksum-index -t framemd5 clip.framemd5 clip.cksumidx
+ *   gst-cksum-index --hash sha1 sink.log sink.cksumidx
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+
+#include "gstcksumref.h"
+
+static gchar *opt_type = (gchar *) "default";
+static gchar *opt_hash = (gchar *) "md5";
+
+static GOptionEntry entries[] = {
+  {"type", 't', 0, G_OPTION_ARG_STRING, &opt_type,
+      "format of the reference: default, framemd5 or hm", "FORMAT"},
+  {"hash", 'a', 0, G_OPTION_ARG_STRING, &opt_hash,
+      "checksum type of the default format (default md5)", "HASH"},
+  {NULL}
+};
+
+static gboolean
+parse_format (const gchar * str, GstCksumRefFormat * format)
+{
+  static const struct
+  {
+    const gchar *name;
+    GstCksumRefFormat format;
+  } formats[] = {
+    {"default", GST_CKSUM_REF_FORMAT_DEFAULT},
+    {"framemd5", GST_CKSUM_REF_FORMAT_FRAMEMD5},
+    {"hm", GST_CKSUM_REF_FORMAT_HM},
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    if (g_ascii_strcasecmp (formats[i].name, str) == 0) {
+      *format = formats[i].format;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GstCksumRefFormat format;
+  GstCksumRef *ref;
+  GError *err = NULL;
+
+  ctx = g_option_context_new ("REFERENCE INDEX - build the index of a "
+      "reference digest file for checksumsink");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc != 3) {
+    g_printerr ("need a reference and an index file\n");
+    return 1;
+  }
+  if (!parse_format (opt_type, &format)) {
+    g_printerr ("unknown reference format '%s'\n", opt_type);
+    return 1;
+  }
+
+  ref = gst_cksum_ref_load (argv[1], format, opt_hash, &err);
+  if (!ref) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  if (!gst_cksum_ref_write_index (ref, opt_hash, argv[2], &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    gst_cksum_ref_free (ref);
+    return 1;
+  }
+
+  g_print ("%" G_GUINT64_FORMAT " frames\n",
+      gst_cksum_ref_get_n_entries (ref));
+  gst_cksum_ref_free (ref);
+
+  return 0;
+}
@@ -0,0 +1,608 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Loading of the reference digest files the sink compares against, and
+ * of the binary indexes built from them.
+ *
+ * An index starts with IndexHeader, followed by one record per frame in
+ * file order, output order for HM: pts and size as 64 bit integers, then
+ * the digest padded with zeroes to digest_size bytes. The positions of
+ * the records sorted on pts come last, as 64 bit integers, then their
+ * positions sorted on digest. All integers are little endian and
+ * everything is 8 byte aligned, so that the index is used in place from
+ * a mapping, whatever its size. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "gstcksumref.h"
+
+#define INDEX_MAGIC "GSTCKIDX"
+#define INDEX_VERSION 2
+
+typedef struct
+{
+  gchar magic[8];
+  guint32 version;
+  guint32 format;
+  gint32 tb_num;
+  gint32 tb_den;
+  guint64 n_entries;
+  guint32 digest_size;
+  guint32 reserved;
+  /* hash of the digests of the default format, else empty */
+  gchar hash_name[16];
+} IndexHeader;
+
+#define RECORD_SIZE(digest_size) (2 * sizeof (gint64) + (digest_size))
+/* a record and its position in both sorted orders */
+#define ENTRY_SIZE(digest_size) \
+    (RECORD_SIZE (digest_size) + 2 * sizeof (guint64))
+
+/* @digest points into the contents of the file, lowered in place */
+static void
+add_entry (GstCksumRef * ref, gint64 pts, gint64 size, gchar * digest)
+{
+  GstCksumRefEntry entry;
+  gchar *c;
+
+  for (c = digest; *c; c++)
+    *c = g_ascii_tolower (*c);
+
+  entry.pts = pts;
+  entry.size = size;
+  entry.digest = digest;
+  g_array_append_val (ref->entries, entry);
+}
+
+/* FrameChecksum lines, named after the hash when the sink printed
+ * several of them */
+static void
+parse_default_line (GstCksumRef * ref, gchar * line, const gchar * hash_name)
+{
+  gchar *hex, *name = NULL;
+
+  if (!g_str_has_prefix (line, "FrameChecksum "))
+    return;
+
+  hex = g_strchug (line + strlen ("FrameChecksum "));
+  if (strchr (hex, ' ')) {
+    name = hex;
+    hex = strchr (hex, ' ');
+    *hex++ = '\0';
+    hex = g_strchug (hex);
+  }
+  if (name && g_ascii_strcasecmp (name, hash_name) != 0)
+    return;
+
+  add_entry (ref, -1, -1, hex);
+}
+
+/* stream#, dts, pts, duration, size, hash; only the first stream is
+ * kept, the header gives the time base of the pts */
+static void
+parse_framemd5_line (GstCksumRef * ref, gchar * line)
+{
+  gchar *fields[6], *p = line;
+  guint n;
+
+  if (line[0] == '#') {
+    sscanf (line, "#tb 0: %d/%d", &ref->tb_num, &ref->tb_den);
+    return;
+  }
+
+  for (n = 0; n < G_N_ELEMENTS (fields) && p; n++) {
+    fields[n] = p;
+    if (n < G_N_ELEMENTS (fields) - 1 && (p = strchr (p, ',')))
+      *p++ = '\0';
+  }
+  if (n == G_N_ELEMENTS (fields) && atoi (fields[0]) == 0)
+    add_entry (ref, g_ascii_strtoll (fields[2], NULL, 10),
+        g_ascii_strtoll (fields[4], NULL, 10), g_strstrip (fields[5]));
+}
+
+/* "POC n ... [MD5:y,u,v,(OK)]", the digests being the ones of the
+ * decoded picture hash SEI followed by the result of the check. IDR and
+ * BLA pictures start a new coded video sequence in @sequences, where the
+ * POC starts again. */
+static void
+parse_hm_line (GstCksumRef * ref, gchar * line, GArray * sequences)
+{
+  gchar *poc, *tag, *end, *d, *next, *out;
+  guint sequence = 0;
+  gsize len;
+
+  if (!(poc = strstr (line, "POC")))
+    return;
+  for (tag = strchr (line, '['); tag; tag = strchr (tag + 1, '[')) {
+    end = tag + 1;
+    while (g_ascii_isalnum (*end))
+      end++;
+    if (end > tag + 1 && *end == ':')
+      break;
+  }
+  if (!tag || !(tag = strchr (tag, ':')) || !(end = strchr (tag, ']')))
+    return;
+  *end = '\0';
+
+  /* joined with commas in place, the result being never longer */
+  out = tag + 1;
+  for (d = tag + 1; d; d = next) {
+    if ((next = strchr (d, ',')))
+      *next++ = '\0';
+    g_strstrip (d);
+    if (*d == '\0' || *d == '(')
+      continue;
+    if (out > tag + 1)
+      *out++ = ',';
+    len = strlen (d);
+    memmove (out, d, len);
+    out += len;
+  }
+  *out = '\0';
+
+  if (sequences->len > 0) {
+    sequence = g_array_index (sequences, guint, sequences->len - 1);
+    if (strstr (line, "IDR") || strstr (line, "BLA"))
+      sequence++;
+  }
+  g_array_append_val (sequences, sequence);
+  add_entry (ref, g_ascii_strtoll (poc + 3, NULL, 10), -1, tag + 1);
+}
+
+static gint
+compare_pts (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  GArray *entries = user_data;
+  guint64 pa = *(const guint64 *) a, pb = *(const guint64 *) b;
+  gint64 ta = g_array_index (entries, GstCksumRefEntry, pa).pts;
+  gint64 tb = g_array_index (entries, GstCksumRefEntry, pb).pts;
+
+  if (ta != tb)
+    return ta < tb ? -1 : 1;
+  return pa < pb ? -1 : pa > pb;
+}
+
+typedef struct
+{
+  GArray *entries;
+  GArray *sequences;
+} OutputOrder;
+
+static gint
+compare_output_order (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  OutputOrder *order = user_data;
+  guint64 pa = *(const guint64 *) a, pb = *(const guint64 *) b;
+  guint sa = g_array_index (order->sequences, guint, pa);
+  guint sb = g_array_index (order->sequences, guint, pb);
+
+  if (sa != sb)
+    return sa < sb ? -1 : 1;
+  return compare_pts (a, b, order->entries);
+}
+
+static gint
+compare_digests (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  GArray *entries = user_data;
+  guint64 pa = *(const guint64 *) a, pb = *(const guint64 *) b;
+  gint cmp = strcmp (g_array_index (entries, GstCksumRefEntry, pa).digest,
+      g_array_index (entries, GstCksumRefEntry, pb).digest);
+
+  if (cmp != 0)
+    return cmp;
+  return pa < pb ? -1 : pa > pb;
+}
+
+/* Returns the positions of the entries of @ref, sorted with @compare */
+static GArray *
+sort_positions (GstCksumRef * ref, GCompareDataFunc compare)
+{
+  GArray *positions;
+  guint64 i;
+
+  positions = g_array_sized_new (FALSE, FALSE, sizeof (guint64),
+      ref->entries->len);
+  for (i = 0; i < ref->entries->len; i++)
+    g_array_append_val (positions, i);
+  g_array_sort_with_data (positions, compare, ref->entries);
+
+  return positions;
+}
+
+/* HM and VTM print the digests of the pictures in decoding order, while
+ * frames are compared in output order: sorts them on POC within each
+ * coded video sequence */
+static void
+sort_output_order (GstCksumRef * ref, GArray * sequences)
+{
+  OutputOrder order = { ref->entries, sequences };
+  GArray *positions, *entries;
+  guint64 i;
+
+  positions = g_array_sized_new (FALSE, FALSE, sizeof (guint64),
+      ref->entries->len);
+  for (i = 0; i < ref->entries->len; i++)
+    g_array_append_val (positions, i);
+  g_array_sort_with_data (positions, compare_output_order, &order);
+
+  entries = g_array_sized_new (FALSE, FALSE, sizeof (GstCksumRefEntry),
+      ref->entries->len);
+  for (i = 0; i < positions->len; i++)
+    g_array_append_val (entries, g_array_index (ref->entries,
+            GstCksumRefEntry, g_array_index (positions, guint64, i)));
+  g_array_unref (positions);
+  g_array_unref (ref->entries);
+  ref->entries = entries;
+}
+
+/* Uses the index in @index in place, after checking that its size
+ * matches its header */
+static GstCksumRef *
+load_index (GMappedFile * index, const gchar * filename,
+    const gchar * hash_name, GError ** error)
+{
+  const guint8 *data = (const guint8 *) g_mapped_file_get_contents (index);
+  gsize size = g_mapped_file_get_length (index);
+  IndexHeader header;
+  GstCksumRef *ref;
+  guint64 n_entries;
+  gsize digest_size;
+
+  memcpy (&header, data, sizeof (IndexHeader));
+  n_entries = GUINT64_FROM_LE (header.n_entries);
+  digest_size = GUINT32_FROM_LE (header.digest_size);
+  header.hash_name[sizeof (header.hash_name) - 1] = '\0';
+
+  if (GUINT32_FROM_LE (header.version) != INDEX_VERSION
+      || GUINT32_FROM_LE (header.format) > GST_CKSUM_REF_FORMAT_HM
+      || digest_size == 0 || digest_size % 8 != 0
+      || n_entries > (size - sizeof (IndexHeader)) /
+      ENTRY_SIZE (digest_size)
+      || size != sizeof (IndexHeader) +
+      n_entries * ENTRY_SIZE (digest_size)) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "%s: corrupt or unsupported index", filename);
+    return NULL;
+  }
+  if (header.hash_name[0]
+      && g_ascii_strcasecmp (header.hash_name, hash_name) != 0) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "%s: index of %s digests", filename, header.hash_name);
+    return NULL;
+  }
+
+  ref = g_new0 (GstCksumRef, 1);
+  ref->format = GUINT32_FROM_LE (header.format);
+  ref->tb_num = GINT32_FROM_LE (header.tb_num);
+  ref->tb_den = GINT32_FROM_LE (header.tb_den);
+  ref->n_entries = n_entries;
+  ref->index = g_mapped_file_ref (index);
+  ref->records = data + sizeof (IndexHeader);
+  ref->sorted = ref->records + n_entries * RECORD_SIZE (digest_size);
+  ref->sorted_digests = ref->sorted + n_entries * sizeof (guint64);
+  ref->digest_size = digest_size;
+
+  return ref;
+}
+
+/* Loads the digests of the frames in @filename, of @format, or the index
+ * it is. Lines that don't hold the digests of a frame are ignored.
+ * @hash_name selects the digests of the default format when there are
+ * several per frame. */
+GstCksumRef *
+gst_cksum_ref_load (const gchar * filename, GstCksumRefFormat format,
+    const gchar * hash_name, GError ** error)
+{
+  GstCksumRef *ref;
+  GMappedFile *index;
+  GArray *sequences;
+  gchar *contents, *line, *next;
+
+  if (!(index = g_mapped_file_new (filename, FALSE, error)))
+    return NULL;
+  if (g_mapped_file_get_length (index) >= sizeof (IndexHeader)
+      && memcmp (g_mapped_file_get_contents (index), INDEX_MAGIC,
+          strlen (INDEX_MAGIC)) == 0) {
+    ref = load_index (index, filename, hash_name, error);
+    g_mapped_file_unref (index);
+    return ref;
+  }
+  g_mapped_file_unref (index);
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    return NULL;
+
+  ref = g_new0 (GstCksumRef, 1);
+  ref->format = format;
+  ref->entries = g_array_new (FALSE, FALSE, sizeof (GstCksumRefEntry));
+  sequences = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  /* split in place, reference files can have millions of lines: the
+   * digests are kept where they are in the contents */
+  for (line = contents; line; line = next) {
+    if ((next = strchr (line, '\n')))
+      *next++ = '\0';
+    g_strstrip (line);
+    if (*line == '\0')
+      continue;
+
+    switch (format) {
+      case GST_CKSUM_REF_FORMAT_FRAMEMD5:
+        parse_framemd5_line (ref, line);
+        break;
+      case GST_CKSUM_REF_FORMAT_HM:
+        parse_hm_line (ref, line, sequences);
+        break;
+      case GST_CKSUM_REF_FORMAT_DEFAULT:
+      default:
+        parse_default_line (ref, line, hash_name);
+        break;
+    }
+  }
+  ref->contents = contents;
+
+  if (format == GST_CKSUM_REF_FORMAT_HM)
+    sort_output_order (ref, sequences);
+  g_array_unref (sequences);
+
+  ref->n_entries = ref->entries->len;
+  ref->order = sort_positions (ref, compare_pts);
+  ref->digest_order = sort_positions (ref, compare_digests);
+
+  return ref;
+}
+
+static guint64
+read_position (const guint8 * positions, guint64 i)
+{
+  guint64 position;
+
+  memcpy (&position, positions + i * sizeof (guint64), sizeof (guint64));
+  return GUINT64_FROM_LE (position);
+}
+
+/* Returns the position of the @i-th entry in digest order, entries with
+ * the same digest being in file order */
+static guint64
+get_sorted_digest (const GstCksumRef * ref, guint64 i)
+{
+  if (ref->digest_order)
+    return g_array_index (ref->digest_order, guint64, i);
+  return read_position (ref->sorted_digests, i);
+}
+
+static gboolean
+write_data (FILE * file, gconstpointer data, gsize size,
+    const gchar * filename, GError ** error)
+{
+  if (fwrite (data, 1, size, file) == size)
+    return TRUE;
+
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+      "%s: %s", filename, g_strerror (errno));
+  return FALSE;
+}
+
+/* Writes the index of @ref to @filename, through a temporary file so
+ * that readers never see a partial one */
+gboolean
+gst_cksum_ref_write_index (const GstCksumRef * ref, const gchar * hash_name,
+    const gchar * filename, GError ** error)
+{
+  IndexHeader header = { {0}, };
+  GstCksumRefEntry entry;
+  gchar *tmp, *digest;
+  gsize len, digest_size = 0;
+  gint64 fields[2];
+  guint64 i, position;
+  gboolean ret = TRUE;
+  FILE *file;
+
+  for (i = 0; i < ref->n_entries; i++) {
+    gst_cksum_ref_get_entry (ref, i, &entry);
+    digest_size = MAX (digest_size, strlen (entry.digest));
+  }
+  /* at least one terminating zero */
+  digest_size = (digest_size + 8) & ~(gsize) 7;
+
+  memcpy (header.magic, INDEX_MAGIC, strlen (INDEX_MAGIC));
+  header.version = GUINT32_TO_LE (INDEX_VERSION);
+  header.format = GUINT32_TO_LE (ref->format);
+  header.tb_num = GINT32_TO_LE (ref->tb_num);
+  header.tb_den = GINT32_TO_LE (ref->tb_den);
+  header.n_entries = GUINT64_TO_LE (ref->n_entries);
+  header.digest_size = GUINT32_TO_LE (digest_size);
+  if (ref->format == GST_CKSUM_REF_FORMAT_DEFAULT)
+    g_strlcpy (header.hash_name, hash_name, sizeof (header.hash_name));
+
+  tmp = g_strconcat (filename, ".tmp", NULL);
+  if (!(file = g_fopen (tmp, "wb"))) {
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+        "%s: %s", tmp, g_strerror (errno));
+    g_free (tmp);
+    return FALSE;
+  }
+
+  digest = g_malloc0 (digest_size);
+  ret = write_data (file, &header, sizeof (IndexHeader), tmp, error);
+  for (i = 0; ret && i < ref->n_entries; i++) {
+    gst_cksum_ref_get_entry (ref, i, &entry);
+    fields[0] = GINT64_TO_LE (entry.pts);
+    fields[1] = GINT64_TO_LE (entry.size);
+    len = strlen (entry.digest);
+    memcpy (digest, entry.digest, len);
+    memset (digest + len, 0, digest_size - len);
+    ret = write_data (file, fields, sizeof (fields), tmp, error)
+        && write_data (file, digest, digest_size, tmp, error);
+  }
+  for (i = 0; ret && i < ref->n_entries; i++) {
+    position = GUINT64_TO_LE (gst_cksum_ref_get_sorted (ref, i));
+    ret = write_data (file, &position, sizeof (guint64), tmp, error);
+  }
+  for (i = 0; ret && i < ref->n_entries; i++) {
+    position = GUINT64_TO_LE (get_sorted_digest (ref, i));
+    ret = write_data (file, &position, sizeof (guint64), tmp, error);
+  }
+  g_free (digest);
+
+  if (fclose (file) != 0 && ret) {
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+        "%s: %s", tmp, g_strerror (errno));
+    ret = FALSE;
+  }
+  if (ret && g_rename (tmp, filename) != 0) {
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+        "%s: %s", filename, g_strerror (errno));
+    ret = FALSE;
+  }
+  if (!ret)
+    g_unlink (tmp);
+  g_free (tmp);
+
+  return ret;
+}
+
+void
+gst_cksum_ref_free (GstCksumRef * ref)
+{
+  if (ref->entries)
+    g_array_unref (ref->entries);
+  g_free (ref->contents);
+  if (ref->order)
+    g_array_unref (ref->order);
+  if (ref->digest_order)
+    g_array_unref (ref->digest_order);
+  if (ref->index)
+    g_mapped_file_unref (ref->index);
+  g_free (ref);
+}
+
+guint64
+gst_cksum_ref_get_n_entries (const GstCksumRef * ref)
+{
+  return ref->n_entries;
+}
+
+/* Fills @entry with the one at @position in the file, in output order
+ * for HM, its digest being owned by @ref. Returns FALSE when there is
+ * none. */
+gboolean
+gst_cksum_ref_get_entry (const GstCksumRef * ref, guint64 position,
+    GstCksumRefEntry * entry)
+{
+  const guint8 *record;
+  gint64 fields[2];
+
+  if (position >= ref->n_entries)
+    return FALSE;
+
+  if (ref->entries) {
+    *entry = g_array_index (ref->entries, GstCksumRefEntry, position);
+    return TRUE;
+  }
+
+  record = ref->records + position * RECORD_SIZE (ref->digest_size);
+  /* digests fill their record in a corrupt index */
+  if (record[RECORD_SIZE (ref->digest_size) - 1] != '\0')
+    return FALSE;
+  memcpy (fields, record, sizeof (fields));
+  entry->pts = GINT64_FROM_LE (fields[0]);
+  entry->size = GINT64_FROM_LE (fields[1]);
+  entry->digest = (gchar *) record + sizeof (fields);
+  return TRUE;
+}
+
+/* Returns the position of the @i-th entry in pts order, entries with the
+ * same pts being in file order */
+guint64
+gst_cksum_ref_get_sorted (const GstCksumRef * ref, guint64 i)
+{
+  if (ref->order)
+    return g_array_index (ref->order, guint64, i);
+  return read_position (ref->sorted, i);
+}
+
+/* Returns the position of the first entry with @pts, or -1, searching
+ * the sorted positions */
+gint64
+gst_cksum_ref_find (const GstCksumRef * ref, gint64 pts)
+{
+  GstCksumRefEntry entry;
+  guint64 lo = 0, hi = ref->n_entries, mid, position;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (!gst_cksum_ref_get_entry (ref, gst_cksum_ref_get_sorted (ref, mid),
+            &entry))
+      return -1;
+    if (entry.pts < pts)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == ref->n_entries)
+    return -1;
+  position = gst_cksum_ref_get_sorted (ref, lo);
+  if (!gst_cksum_ref_get_entry (ref, position, &entry) || entry.pts != pts)
+    return -1;
+  return position;
+}
+
+/* Looks @digest up in the positions sorted on digest. Returns the number
+ * of entries with it, counting only up to 2, and sets @position to the
+ * first of them in file order. */
+guint
+gst_cksum_ref_find_digest (const GstCksumRef * ref, const gchar * digest,
+    guint64 * position)
+{
+  GstCksumRefEntry entry;
+  guint64 lo = 0, hi = ref->n_entries, mid;
+  guint n;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (!gst_cksum_ref_get_entry (ref, get_sorted_digest (ref, mid), &entry))
+      return 0;
+    if (strcmp (entry.digest, digest) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  for (n = 0; n < 2 && lo + n < ref->n_entries; n++) {
+    if (!gst_cksum_ref_get_entry (ref, get_sorted_digest (ref, lo + n),
+            &entry) || strcmp (entry.digest, digest) != 0)
+      break;
+  }
+  if (n > 0)
+    *position = get_sorted_digest (ref, lo);
+  return n;
+}
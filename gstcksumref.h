@@ -0,0 +1,96 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef _GST_CKSUM_REF_H_
+#define _GST_CKSUM_REF_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstCksumRef GstCksumRef;
+typedef struct _GstCksumRefEntry GstCksumRefEntry;
+
+/* digest files the sink prints and compares against: its own lines,
+ * ffmpeg -f framemd5 output and the per picture digests printed by the
+ * HM and VTM reference decoders */
+typedef enum
+{
+  GST_CKSUM_REF_FORMAT_DEFAULT,
+  GST_CKSUM_REF_FORMAT_FRAMEMD5,
+  GST_CKSUM_REF_FORMAT_HM
+} GstCksumRefFormat;
+
+/* the digests of a frame, the ones of each plane separated by commas in
+ * the HM format */
+struct _GstCksumRefEntry
+{
+  /* pts of framemd5 in the time base of the file, POC of HM, else -1 */
+  gint64 pts;
+  /* size of the frame in framemd5, else -1 */
+  gint64 size;
+  gchar *digest;
+};
+
+/* The digests are either parsed from a text file, or read in place from
+ * a binary index built from one (see gstcksumref.c), which holds the
+ * entries in file order followed by their positions sorted on pts and on
+ * digest */
+struct _GstCksumRef
+{
+  GstCksumRefFormat format;
+  /* time base of the pts of framemd5, 0/0 otherwise */
+  gint tb_num;
+  gint tb_den;
+
+  /*< private > */
+  guint64 n_entries;
+  /* GstCksumRefEntry in file order, output order for HM, their digests
+   * pointing into the contents of the file, and their positions sorted
+   * on pts and on digest */
+  GArray *entries;
+  gchar *contents;
+  GArray *order;
+  GArray *digest_order;
+  /* or the records and sorted positions of an index */
+  GMappedFile *index;
+  const guint8 *records;
+  const guint8 *sorted;
+  const guint8 *sorted_digests;
+  gsize digest_size;
+};
+
+GstCksumRef *gst_cksum_ref_load (const gchar * filename,
+    GstCksumRefFormat format, const gchar * hash_name, GError ** error);
+gboolean gst_cksum_ref_write_index (const GstCksumRef * ref,
+    const gchar * hash_name, const gchar * filename, GError ** error);
+void gst_cksum_ref_free (GstCksumRef * ref);
+
+guint64 gst_cksum_ref_get_n_entries (const GstCksumRef * ref);
+gboolean gst_cksum_ref_get_entry (const GstCksumRef * ref, guint64 position,
+    GstCksumRefEntry * entry);
+guint64 gst_cksum_ref_get_sorted (const GstCksumRef * ref, guint64 i);
+gint64 gst_cksum_ref_find (const GstCksumRef * ref, gint64 pts);
+guint gst_cksum_ref_find_digest (const GstCksumRef * ref,
+    const gchar * digest, guint64 * position);
+
+G_END_DECLS
+
+#endif
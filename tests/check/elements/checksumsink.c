@@ -0,0 +1,180 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#define WIDTH 64
+#define HEIGHT 48
+#define N_FRAMES 16
+
+#ifdef HAVE___LIBC_MALLOC
+/* counts the allocations of the thread pushing the frames, which is the
+ * one rendering them */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static __thread gboolean counting;
+static __thread guint n_allocs;
+
+void *
+malloc (size_t size)
+{
+  if (counting)
+    n_allocs++;
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  if (counting)
+    n_allocs++;
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  if (counting)
+    n_allocs++;
+  return __libc_realloc (ptr, size);
+}
+#endif
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-raw"));
+
+static GstElement *
+setup_checksumsink (void)
+{
+  GstElement *sink;
+
+  sink = gst_check_setup_element ("checksumsink2");
+  /* neither the last sample nor the clock wait should allocate */
+  g_object_set (sink, "sync", FALSE, "qos", FALSE, "enable-last-sample",
+      FALSE, NULL);
+  return sink;
+}
+
+/* Pushes N_FRAMES frames to @sink and returns the number of allocations
+ * done while rendering all but the first one */
+static guint
+render_frames (GstElement * sink)
+{
+  GstBuffer *buffers[N_FRAMES];
+  GstVideoInfo vinfo;
+  GstPad *srcpad;
+  GstCaps *caps;
+  guint i, allocs = 0;
+
+  srcpad = gst_check_setup_src_pad (sink, &srctemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  gst_video_info_set_format (&vinfo, GST_VIDEO_FORMAT_I420, WIDTH, HEIGHT);
+  caps = gst_video_info_to_caps (&vinfo);
+  gst_check_setup_events (srcpad, sink, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < N_FRAMES; i++) {
+    buffers[i] = gst_buffer_new_allocate (NULL, vinfo.size, NULL);
+    gst_buffer_memset (buffers[i], 0, i, vinfo.size);
+    GST_BUFFER_PTS (buffers[i]) = i * GST_SECOND / 30;
+    GST_BUFFER_DURATION (buffers[i]) = GST_SECOND / 30;
+  }
+
+  /* the first frame prerolls and sets up the hash contexts */
+  fail_unless_equals_int (gst_pad_push (srcpad, buffers[0]), GST_FLOW_OK);
+  for (i = 1; i < N_FRAMES; i++) {
+#ifdef HAVE___LIBC_MALLOC
+    n_allocs = 0;
+    counting = TRUE;
+#endif
+    fail_unless_equals_int (gst_pad_push (srcpad, buffers[i]), GST_FLOW_OK);
+#ifdef HAVE___LIBC_MALLOC
+    counting = FALSE;
+    allocs += n_allocs;
+#endif
+  }
+
+  gst_element_set_state (sink, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_check_teardown_src_pad (sink);
+  gst_check_teardown_element (sink);
+
+  return allocs;
+}
+
+GST_START_TEST (test_render_no_alloc)
+{
+  GstElement *sink = setup_checksumsink ();
+
+  g_object_set (sink, "plane-checksum", TRUE, NULL);
+  fail_unless_equals_int (render_frames (sink), 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_render_hm_no_alloc)
+{
+  GstElement *sink = setup_checksumsink ();
+
+  gst_util_set_object_arg (G_OBJECT (sink), "output-format", "hm");
+  fail_unless_equals_int (render_frames (sink), 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_render_stream_checksum_no_alloc)
+{
+  GstElement *sink = setup_checksumsink ();
+
+  g_object_set (sink, "stream-checksum", TRUE, NULL);
+  gst_util_set_object_arg (G_OBJECT (sink), "hashes", "md5+crc32");
+  fail_unless_equals_int (render_frames (sink), 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+checksumsink_suite (void)
+{
+  Suite *s = suite_create ("checksumsink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_render_no_alloc);
+  tcase_add_test (tc_chain, test_render_hm_no_alloc);
+  tcase_add_test (tc_chain, test_render_stream_checksum_no_alloc);
+
+  return s;
+}
+
+GST_CHECK_MAIN (checksumsink);